@@ -17,13 +17,19 @@
 #ifndef INCLUDED_IEEE802_11_CHUNKS_TO_SYMBOLS_H
 #define INCLUDED_IEEE802_11_CHUNKS_TO_SYMBOLS_H
 
-#include <gnuradio/tagged_stream_block.h>
+#include <gnuradio/sync_block.h>
 #include <ieee802_11/api.h>
 
 namespace gr {
 namespace ieee802_11 {
 
-class IEEE802_11_API chunks_to_symbols : virtual public tagged_stream_block
+/*!
+ * \brief Maps constellation indices to complex points.
+ *
+ * The constellation follows the encoding tags in the stream, which can
+ * change from one item to the next, so several packets are mapped per call.
+ */
+class IEEE802_11_API chunks_to_symbols : virtual public sync_block
 {
 public:
     typedef std::shared_ptr<chunks_to_symbols> sptr;
@@ -68,6 +68,17 @@ protected:
     constellation_64qam();
 };
 
+class IEEE802_11_API constellation_256qam : virtual public digital::constellation
+{
+public:
+    typedef std::shared_ptr<gr::ieee802_11::constellation_256qam> sptr;
+    static sptr make();
+    sptr base() { return std::dynamic_pointer_cast<gr::ieee802_11::constellation_256qam>(shared_from_this()); }
+
+protected:
+    constellation_256qam();
+};
+
 } // namespace ieee802_11
 } // namespace gr
 
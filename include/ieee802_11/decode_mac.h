@@ -23,11 +23,33 @@
 namespace gr {
 namespace ieee802_11 {
 
+/*!
+ * Decodes the DATA field of a frame and publishes every MPDU with a valid
+ * FCS, without the FCS, on the out port.
+ *
+ * With sifs_ack, unicast data and management frames to src_mac are
+ * acknowledged right here, ahead of the MAC, to meet SIFS: once the FCS
+ * checks out, the ACK (an NDP ACK with ndp_ack, its Ack ID taken from the
+ * FCS) goes out on the ack port as a PDU of baseband samples for a PDU to
+ * Tagged Stream block in front of the radio. Its tx_time is SIFS after the
+ * end of the received PPDU, on the sample clock of the rx_time tags of the
+ * radio. The waveforms are not modulated on the spot: all NDP ACKs are
+ * computed up front and the ACK to a transmitter once, on its first frame.
+ * The turnaround, the time from the last DATA symbol reaching the block to
+ * the ACK going out, is in the metadata in samples; with log, it is also
+ * printed. A-MPDUs and frames with the short MAC header are not
+ * acknowledged here. The MAC of this node has to be made with sifs_ack,
+ * so that it does not ACK on top, its ACKs would come late.
+ */
 class IEEE802_11_API decode_mac : virtual public block
 {
 public:
     typedef std::shared_ptr<decode_mac> sptr;
-    static sptr make(bool log = false, bool debug = false);
+    static sptr make(bool log = false,
+                     bool debug = false,
+                     bool sifs_ack = false,
+                     std::vector<uint8_t> src_mac = std::vector<uint8_t>(6, 0x23),
+                     bool ndp_ack = false);
 };
 
 } // namespace ieee802_11
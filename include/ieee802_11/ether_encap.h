@@ -23,11 +23,19 @@
 namespace gr {
 namespace ieee802_11 {
 
+/*!
+ * Converts between Ethernet frames of a TAP device and MSDUs with LLC/SNAP.
+ * With short_header, received data frames with the S1G short MAC header
+ * (PV1) are converted as well. They carry the AID of the station instead of
+ * its address, which is taken to be sta_mac.
+ */
 class IEEE802_11_API ether_encap : virtual public block
 {
 public:
     typedef std::shared_ptr<ether_encap> sptr;
-    static sptr make(bool debug);
+    static sptr make(bool debug,
+                     bool short_header = false,
+                     std::vector<uint8_t> sta_mac = std::vector<uint8_t>(6, 0x42));
 };
 
 } // namespace ieee802_11
@@ -33,7 +33,12 @@ enum Equalizer {
     STA = 3,
 };
 
-
+/*!
+ * Equalizes the symbols of a frame and decodes its SIG field. NDPs end after
+ * the SIG field, they are not passed on to decode_mac but published on the
+ * ndp port, with the 25 bit body under "ndp" in the metadata, the decoded
+ * type and fields and an empty blob.
+ */
 class IEEE802_11_API frame_equalizer : virtual public gr::block
 {
 
@@ -19,17 +19,114 @@
 
 #include <gnuradio/block.h>
 #include <ieee802_11/api.h>
+#include <ieee802_11/mapper.h>
 
 namespace gr {
 namespace ieee802_11 {
 
+/*!
+ * MSDUs are queued per EDCA access category (VO, VI, BE, BK, at most
+ * queue_limits[i] MSDUs each). The category follows from an integer user
+ * priority (0-7) under "priority" in the PDU metadata or else from the DSCP
+ * of an IPv4 or IPv6 packet behind LLC/SNAP. The queues are served by
+ * priority, but MSDUs move up one category per 20 ms of waiting. The next
+ * frame is released once the airtime of the previous one (at the encoding
+ * picked by rate control or else at the PHY default encoding) and DIFS have
+ * passed. Depth, drops and sojourn times of the queues are published as a
+ * dict on the stats port after every transmission.
+ *
+ * With ampdu_size > 0, the MSDUs of a queue are not sent one by one but as
+ * an A-MPDU once they fill ampdu_size bytes or the first one waited
+ * ampdu_delay seconds. The PHY drops A-MPDUs longer than 511 symbols, so
+ * an A-MPDU takes no more MSDUs than fit into them at the MCS of the frame
+ * (764 bytes at MCS0, about 10 kB at MCS9).
+ *
+ * MSDUs whose MPDU is longer than frag_threshold bytes are fragmented, the
+ * default fits the 511 byte PSDU limit of a single MPDU PPDU. Without
+ * A-MPDUs, frag_threshold can not be higher than that. Received
+ * fragments are reassembled per transmitter and sequence number.
+ *
+ * With arq, unicast MPDUs are sent stop-and-wait: the next one goes out once
+ * the previous one is acknowledged, a missing ACK triggers up to retry_limit
+ * retransmissions after ack_timeout seconds each. Unicast data addressed to
+ * src_mac is acknowledged. ARQ does not work with A-MPDUs. loss_rate drops
+ * that share of the received frames, to test ARQ in loopback.
+ *
+ * With rate_control, the MCS of every frame to dst_mac is picked from the
+ * average SNR of the frames received from it, the mapper or modulator has to
+ * honor the encoding in the PDU metadata. Without recent frames from dst_mac,
+ * their default encoding is used. ARQ retries step down one MCS each.
+ * Set ldpc if the PHY codes with LDPC: MCS10 has no LDPC, rate control and
+ * retries then stop at MCS0.
+ *
+ * With short_header, data frames carry the 12 byte S1G short MAC header (PV1)
+ * instead of the 24 byte legacy one. The link has to be between the AP, whose
+ * MAC is bss_mac, and the station with the given AID (1-8191): the AP sends
+ * with src_mac = bss_mac, the station with dst_mac = bss_mac. The station is
+ * addressed by its AID, the AP by the BSSID, and the user priority goes into
+ * the TID. PV1 frames of other links are dropped. ACKs keep the legacy
+ * format, PV1 has no retry bit so a repeated sequence number is taken as a
+ * duplicate.
+ *
+ * With ndp_ack, ARQ acknowledges with NDP ACKs, which end after the SIG
+ * field. Their Ack ID is taken from the FCS of the acknowledged MPDU. NDPs
+ * reach phy in straight from the frame equalizer; NDP ACKs are always
+ * accepted, whatever ndp_ack is set to.
+ *
+ * With sifs_ack, decode_mac acknowledges the received frames within SIFS
+ * (its sifs_ack has to be set as well) and the MAC sends no ACKs, but
+ * still drops duplicates and runs ARQ for its own frames. As ACK frames
+ * carry no sequence number, one is only taken once the acknowledged MPDU
+ * is over, so a late ACK of the previous MPDU does not acknowledge the next.
+ *
+ * With csma, frames are sent with CSMA/CA: an access category transmits
+ * once the medium was idle for its AIFS and a random backoff of 0 to CW
+ * slots (52 us), with the default S1G EDCA parameters. The backoff stops
+ * while the medium is busy and goes on where it left off. Without an ACK,
+ * ARQ doubles the CW for the retry. The state of the medium comes from the
+ * clear channel assessment of sync_short on the cca port, and the slots are
+ * counted on its sample indices, so they are exact however late the
+ * messages arrive. Between messages the sample clock runs on the host
+ * clock. Own frames keep the medium busy for their airtime.
+ *
+ * With duty_cycle < 1, the own PPDUs (ACKs included) take up at most
+ * duty_cycle of the airtime of any duty_window seconds, as sub-GHz
+ * regulations require. Every PPDU is charged with its airtime from the
+ * number of symbols of the DATA field, with BCC or LDPC, whichever is
+ * longer. A frame that does not fit waits until older PPDUs leave the
+ * window, while others that do fit may go first; an A-MPDU takes only as
+ * many MSDUs as fit. ACKs that do not fit are not sent. MSDUs that do not
+ * even fit into an empty window are dropped. The airtime used in the
+ * current window is in the stats. Every PPDU carries the encoding it was
+ * charged with in the PDU metadata, the PHY default encoding unless rate
+ * control picks one, so the mapper or modulator has to honor it. The ACKs
+ * of decode_mac bypass the budget, so sifs_ack is not supported.
+ */
 class IEEE802_11_API mac : virtual public block
 {
 public:
     typedef std::shared_ptr<mac> sptr;
     static sptr make(std::vector<uint8_t> src_mac,
                      std::vector<uint8_t> dst_mac,
-                     std::vector<uint8_t> bss_mac);
+                     std::vector<uint8_t> bss_mac,
+                     int ampdu_size = 0,
+                     double ampdu_delay = 0.01,
+                     int frag_threshold = 511,
+                     bool arq = false,
+                     int retry_limit = 7,
+                     double ack_timeout = 0.05,
+                     double loss_rate = 0,
+                     bool rate_control = false,
+                     Encoding encoding = BPSK_1_2,
+                     std::vector<int> queue_limits = std::vector<int>{ 16, 16, 64, 64 },
+                     bool short_header = false,
+                     int aid = 1,
+                     bool ndp_ack = false,
+                     bool csma = false,
+                     double duty_cycle = 1,
+                     double duty_window = 3600,
+                     bool sifs_ack = false,
+                     bool ldpc = false);
 };
 
 } // namespace ieee802_11
@@ -33,6 +33,8 @@ enum Encoding {
     QAM64_2_3 = 5,
     QAM64_3_4 = 6,
     QAM64_5_6 = 7,
+    QAM256_3_4 = 8,
+    QAM256_5_6 = 9,
     BPSK_1_2_REP = 10,
 };
 
@@ -45,8 +47,11 @@ class IEEE802_11_API mapper : virtual public block
 {
 public:
     typedef std::shared_ptr<mapper> sptr;
-    static sptr make(Encoding mcs, bool debug = false);
+    static sptr make(Encoding mcs, bool debug = false, bool ldpc = false);
+    // default for PDUs without an integer encoding (MCS) in their metadata
     virtual void set_encoding(Encoding mcs) = 0;
+    // LDPC instead of BCC for the DATA field, not available with MCS10
+    virtual void set_ldpc(bool ldpc) = 0;
 };
 
 } // namespace ieee802_11
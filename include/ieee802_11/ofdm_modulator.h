@@ -0,0 +1,79 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef INCLUDED_IEEE802_11_OFDM_MODULATOR_H
+#define INCLUDED_IEEE802_11_OFDM_MODULATOR_H
+
+#include <gnuradio/block.h>
+#include <ieee802_11/api.h>
+#include <ieee802_11/mapper.h>
+
+namespace gr {
+namespace ieee802_11 {
+
+/*!
+ * \brief HaLow 1 MHz transmitter in a single block.
+ *
+ * Takes PSDUs as PDUs and outputs the baseband samples of the complete
+ * frame: STF, LTF1, SIG and DATA with pilots, IFFT and guard intervals.
+ * Replaces the mapper, header generator, tagged stream mux, chunks to
+ * symbols, carrier allocator, FFT and cyclic prefixer chain.
+ *
+ * The frame is modulated symbol by symbol as output space becomes
+ * available, so downstream buffers do not have to hold a complete frame.
+ * The first sample of a frame is tagged with packet_len (in samples),
+ * psdu_len, encoding and aggregation.
+ *
+ * PDUs with aggregation set in their metadata are A-MPDUs. They are padded
+ * to fill their last symbol and the SIG field signals the number of symbols.
+ *
+ * An integer encoding in the metadata selects the MCS of that packet, e.g.
+ * set by rate control in the MAC, the block's encoding is the default.
+ *
+ * An integer ndp in the metadata makes the packet an NDP: the SIG field
+ * carries its 25 bit body and the frame ends after it. The blob is ignored.
+ * NDPs are tagged with packet_len and ndp.
+ *
+ * With cache_size > 0, up to cache_size bytes of samples of recent frames
+ * are kept and sent again without encoding and modulation. A frame whose
+ * PSDU and encoding were sent not long ago goes out with a fixed scrambler
+ * seed and is cached, frames that are sent once do not take up the cache.
+ * The hit and miss counters and the size of the cache are published as a
+ * dict on the cache port after every frame.
+ *
+ * With short_gi, the DATA symbols after the first one get a 4 us guard
+ * interval and the SIG field signals it.
+ *
+ * With ldpc, the DATA field is LDPC instead of BCC coded. MCS10 has no LDPC
+ * mode, packets with this encoding are dropped.
+ */
+class IEEE802_11_API ofdm_modulator : virtual public block
+{
+public:
+    typedef std::shared_ptr<ofdm_modulator> sptr;
+    static sptr
+    make(Encoding mcs,
+         bool debug = false,
+         int cache_size = 0,
+         bool short_gi = false,
+         bool ldpc = false);
+    virtual void set_encoding(Encoding mcs) = 0;
+    virtual void set_short_gi(bool short_gi) = 0;
+    virtual void set_ldpc(bool ldpc) = 0;
+};
+
+} // namespace ieee802_11
+} // namespace gr
+
+#endif /* INCLUDED_IEEE802_11_OFDM_MODULATOR_H */
@@ -23,11 +23,20 @@
 namespace gr {
 namespace ieee802_11 {
 
+/*!
+ * \brief Finds the LTF and forwards the frame without guard intervals.
+ *
+ * With short_gi, the DATA field of each frame is held back until the frame
+ * equalizer reports the GI from the SIG field on the gi port.
+ */
 class IEEE802_11_API sync_long : virtual public block
 {
 public:
     typedef std::shared_ptr<sync_long> sptr;
-    static sptr make(unsigned int sync_length, bool log = false, bool debug = false);
+    static sptr make(unsigned int sync_length,
+                     bool log = false,
+                     bool debug = false,
+                     bool short_gi = false);
 };
 
 } // namespace ieee802_11
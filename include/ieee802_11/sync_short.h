@@ -23,6 +23,17 @@
 namespace gr {
 namespace ieee802_11 {
 
+/*!
+ * Detects frames by the plateau of the STF autocorrelation and copies them
+ * to the output, tagged with wifi_start.
+ *
+ * It also does clear channel assessment: the medium is busy for the
+ * shortest PPDU (640 us) after a preamble is detected, and while the
+ * average power of the samples is above cca_threshold (dB, relative to a
+ * power of 1). Every change is published on the cca port as a dict with
+ * busy (bool) and sample, the index of the first input sample of the new
+ * state. The MAC counts its backoff slots on these sample indices.
+ */
 class IEEE802_11_API sync_short : virtual public block
 {
 public:
@@ -30,7 +41,8 @@ public:
     static sptr make(double threshold,
                      unsigned int min_plateau,
                      bool log = false,
-                     bool debug = false);
+                     bool debug = false,
+                     double cca_threshold = -20);
 };
 
 } // namespace ieee802_11
@@ -17,7 +17,7 @@
 #include "chunks_to_symbols_impl.h"
 #include "utils.h"
 #include <gnuradio/io_signature.h>
-#include <assert.h>
+#include <algorithm>
 
 using namespace gr::ieee802_11;
 
@@ -27,69 +27,86 @@ chunks_to_symbols::sptr chunks_to_symbols::make()
 }
 
 chunks_to_symbols_impl::chunks_to_symbols_impl()
-    : tagged_stream_block("chunks_to_symbols",
-                          io_signature::make(1, 1, sizeof(char)),
-                          io_signature::make(1, 1, sizeof(gr_complex)),
-                          "packet_len")
+    : sync_block("chunks_to_symbols",
+                 io_signature::make(1, 1, sizeof(char)),
+                 io_signature::make(1, 1, sizeof(gr_complex)))
 {
 
-    d_bpsk = constellation_bpsk::make();
-    d_qpsk = constellation_qpsk::make();
-    d_16qam = constellation_16qam::make();
-    d_64qam = constellation_64qam::make();
+    d_bpsk = constellation_bpsk::make()->points();
+    d_qpsk = constellation_qpsk::make()->points();
+    d_16qam = constellation_16qam::make()->points();
+    d_64qam = constellation_64qam::make()->points();
+    d_256qam = constellation_256qam::make()->points();
 
-    d_mapping = d_bpsk;
+    d_mapping = d_bpsk.data();
 }
 
 chunks_to_symbols_impl::~chunks_to_symbols_impl() {}
 
 
-int chunks_to_symbols_impl::work(int noutput_items,
-                                 gr_vector_int& ninput_items,
-                                 gr_vector_const_void_star& input_items,
-                                 gr_vector_void_star& output_items)
+void chunks_to_symbols_impl::set_encoding(Encoding encoding)
 {
-
-    const unsigned char* in = (unsigned char*)input_items[0];
-    gr_complex* out = (gr_complex*)output_items[0];
-
-    std::vector<tag_t> tags;
-    get_tags_in_range(
-        tags, 0, nitems_read(0), nitems_read(0) + ninput_items[0], pmt::mp("encoding"));
-    if (tags.size() != 1) {
-        throw std::runtime_error("no encoding in input stream");
-    }
-
-    Encoding encoding = (Encoding)pmt::to_long(tags[0].value);
     switch (encoding) {
     case BPSK_1_2:
     case BPSK_1_2_REP:
-        d_mapping = d_bpsk;
+        d_mapping = d_bpsk.data();
         break;
 
     case QPSK_1_2:
     case QPSK_3_4:
-        d_mapping = d_qpsk;
+        d_mapping = d_qpsk.data();
         break;
 
     case QAM16_1_2:
     case QAM16_3_4:
-        d_mapping = d_16qam;
+        d_mapping = d_16qam.data();
         break;
 
     case QAM64_2_3:
     case QAM64_3_4:
-        d_mapping = d_64qam;
+    case QAM64_5_6:
+        d_mapping = d_64qam.data();
+        break;
+
+    case QAM256_3_4:
+    case QAM256_5_6:
+        d_mapping = d_256qam.data();
         break;
 
     default:
         throw std::invalid_argument("wrong encoding");
         break;
     }
+}
+
 
-    for (int i = 0; i < ninput_items[0]; i++) {
-        d_mapping->map_to_points(in[i], out + i);
+int chunks_to_symbols_impl::work(int noutput_items,
+                                 gr_vector_const_void_star& input_items,
+                                 gr_vector_void_star& output_items)
+{
+
+    const unsigned char* in = (unsigned char*)input_items[0];
+    gr_complex* out = (gr_complex*)output_items[0];
+
+    std::vector<tag_t> tags;
+    get_tags_in_window(tags, 0, 0, noutput_items, pmt::mp("encoding"));
+    std::sort(tags.begin(), tags.end(), gr::tag_t::offset_compare);
+
+    // each encoding tag switches the table from its item on, items before
+    // the first tag belong to the packet of the previous call
+    int i = 0;
+    for (int t = 0; t <= (int)tags.size(); t++) {
+        int end = t < (int)tags.size() ? tags[t].offset - nitems_read(0) : noutput_items;
+
+        const gr_complex* mapping = d_mapping;
+        for (; i < end; i++) {
+            out[i] = mapping[in[i]];
+        }
+
+        if (t < (int)tags.size()) {
+            set_encoding((Encoding)pmt::to_long(tags[t].value));
+        }
     }
 
-    return ninput_items[0];
+    return noutput_items;
 }
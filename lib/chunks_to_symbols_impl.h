@@ -19,6 +19,7 @@
 
 #include <ieee802_11/chunks_to_symbols.h>
 #include <ieee802_11/constellations.h>
+#include <ieee802_11/mapper.h>
 
 namespace gr {
 namespace ieee802_11 {
@@ -30,16 +31,19 @@ public:
     ~chunks_to_symbols_impl();
 
     int work(int noutput_items,
-             gr_vector_int& ninput_itmes,
              gr_vector_const_void_star& input_items,
              gr_vector_void_star& output_items);
 
 private:
-    std::shared_ptr<gr::digital::constellation> d_mapping;
-    constellation_bpsk::sptr d_bpsk;
-    constellation_qpsk::sptr d_qpsk;
-    constellation_16qam::sptr d_16qam;
-    constellation_64qam::sptr d_64qam;
+    void set_encoding(Encoding encoding);
+
+    // points of the constellation in use, indexed by symbol value
+    const gr_complex* d_mapping;
+    std::vector<gr_complex> d_bpsk;
+    std::vector<gr_complex> d_qpsk;
+    std::vector<gr_complex> d_16qam;
+    std::vector<gr_complex> d_64qam;
+    std::vector<gr_complex> d_256qam;
 };
 
 } /* namespace ieee802_11 */
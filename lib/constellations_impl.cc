@@ -16,8 +16,63 @@
  */
 #include "constellations_impl.h"
 
+#include <algorithm>
+#include <cmath>
+
 using namespace gr::ieee802_11;
 
+void soft_demapper::set_axes(const std::vector<gr_complex>& points,
+                             int i_bits,
+                             int q_bits)
+{
+    d_bits[0] = i_bits;
+    d_bits[1] = q_bits;
+    d_min_distance = INFINITY;
+
+    for (int axis = 0; axis < 2; axis++) {
+        for (int v = 0; v < (1 << d_bits[axis]); v++) {
+            // the other axis at its lowest index
+            d_levels[axis][v] =
+                axis ? points[v << i_bits].imag() : points[v].real();
+            for (int w = 0; w < v; w++) {
+                float d = d_levels[axis][v] - d_levels[axis][w];
+                d_min_distance = std::min(d_min_distance, d * d);
+            }
+        }
+    }
+}
+
+void soft_demapper::demap_axis(float x, int axis, float* llr) const
+{
+    const int bits = d_bits[axis];
+    float d0[MAX_AXIS_BITS];
+    float d1[MAX_AXIS_BITS];
+    std::fill(d0, d0 + bits, INFINITY);
+    std::fill(d1, d1 + bits, INFINITY);
+
+    for (int v = 0; v < (1 << bits); v++) {
+        float d = x - d_levels[axis][v];
+        d *= d;
+        for (int b = 0; b < bits; b++) {
+            float& m = (v & (1 << b)) ? d1[b] : d0[b];
+            m = std::min(m, d);
+        }
+    }
+
+    for (int b = 0; b < bits; b++) {
+        llr[b] = d1[b] - d0[b];
+    }
+}
+
+void soft_demapper::demap(const gr_complex& sample, float* llr) const
+{
+    // the distance on the other axis is the same for both values of a bit
+    demap_axis(sample.real(), 0, llr);
+    demap_axis(sample.imag(), 1, llr + d_bits[0]);
+}
+
+/**********************************************************/
+
 constellation_bpsk::sptr constellation_bpsk::make()
 {
     return constellation_bpsk::sptr(new constellation_bpsk_impl());
@@ -33,6 +88,7 @@ constellation_bpsk_impl::constellation_bpsk_impl()
     d_rotational_symmetry = 2;
     d_dimensionality = 1;
     calc_arity();
+    set_axes(d_constellation, 1, 0);
 }
 
 constellation_bpsk_impl::~constellation_bpsk_impl() {}
@@ -65,6 +121,7 @@ constellation_qpsk_impl::constellation_qpsk_impl()
     d_rotational_symmetry = 4;
     d_dimensionality = 1;
     calc_arity();
+    set_axes(d_constellation, 1, 1);
 }
 
 constellation_qpsk_impl::~constellation_qpsk_impl() {}
@@ -109,6 +166,7 @@ constellation_16qam_impl::constellation_16qam_impl()
     d_rotational_symmetry = 4;
     d_dimensionality = 1;
     calc_arity();
+    set_axes(d_constellation, 2, 2);
 }
 
 constellation_16qam_impl::~constellation_16qam_impl() {}
@@ -211,6 +269,7 @@ constellation_64qam_impl::constellation_64qam_impl()
     d_rotational_symmetry = 4;
     d_dimensionality = 1;
     calc_arity();
+    set_axes(d_constellation, 3, 3);
 }
 
 constellation_64qam_impl::~constellation_64qam_impl() {}
@@ -231,3 +290,60 @@ unsigned int constellation_64qam_impl::decision_maker(const gr_complex* sample)
 
     return ret;
 }
+
+
+/**********************************************************/
+
+constellation_256qam::sptr constellation_256qam::make()
+{
+    return constellation_256qam::sptr(new constellation_256qam_impl());
+}
+
+constellation_256qam::constellation_256qam() {}
+
+// Gray-coded like 64-QAM: the lowest bit of an axis is the sign, the others
+// split the magnitude at 8, between 4 and 12 and between 2/6 and 10/14
+const int constellation_256qam_impl::LEVELS[8] = { 15, 1, 9, 7, 13, 3, 11, 5 };
+
+constellation_256qam_impl::constellation_256qam_impl()
+{
+    const float level = sqrt(float(1 / 170.0));
+    d_constellation.resize(256);
+
+    // bits 0-3 select the in-phase, bits 4-7 the quadrature amplitude
+    for (int i = 0; i < 256; i++) {
+        int re = LEVELS[(i >> 1) & 7] * ((i & 1) ? 1 : -1);
+        int im = LEVELS[(i >> 5) & 7] * ((i & 16) ? 1 : -1);
+        d_constellation[i] = gr_complex(re * level, im * level);
+    }
+
+    d_rotational_symmetry = 4;
+    d_dimensionality = 1;
+    calc_arity();
+    set_axes(d_constellation, 4, 4);
+}
+
+constellation_256qam_impl::~constellation_256qam_impl() {}
+
+unsigned int constellation_256qam_impl::decision_maker(const gr_complex* sample)
+{
+    unsigned int ret = 0;
+    const float level = sqrt(float(1 / 170.0));
+    float re = std::abs(sample->real());
+    float im = std::abs(sample->imag());
+
+    ret |= sample->real() > 0;
+    ret |= (re < (8 * level)) << 1;
+    ret |= (re < (12 * level) && re > (4 * level)) << 2;
+    ret |= (std::abs(re - 8 * level) < (6 * level) &&
+            std::abs(re - 8 * level) > (2 * level))
+           << 3;
+    ret |= (sample->imag() > 0) << 4;
+    ret |= (im < (8 * level)) << 5;
+    ret |= (im < (12 * level) && im > (4 * level)) << 6;
+    ret |= (std::abs(im - 8 * level) < (6 * level) &&
+            std::abs(im - 8 * level) > (2 * level))
+           << 7;
+
+    return ret;
+}
@@ -22,7 +22,36 @@
 namespace gr {
 namespace ieee802_11 {
 
-class constellation_bpsk_impl : public constellation_bpsk
+// Max-log soft demapping of the Gray coded constellations below. The in-phase
+// bits sit below the quadrature bits, so each axis is demapped on its own,
+// over its at most 16 levels instead of all points.
+class soft_demapper
+{
+public:
+    virtual ~soft_demapper() {}
+
+    // LLRs of the bits of one point, d1 - d0 in squared distance, positive means 0
+    void demap(const gr_complex& sample, float* llr) const;
+
+    // squared distance between neighbouring points
+    float min_distance() const { return d_min_distance; }
+
+protected:
+    // take the levels of both axes from the points
+    void set_axes(const std::vector<gr_complex>& points, int i_bits, int q_bits);
+
+private:
+    static const int MAX_AXIS_BITS = 4;
+
+    void demap_axis(float x, int axis, float* llr) const;
+
+    int d_bits[2];
+    float d_levels[2][1 << MAX_AXIS_BITS];
+    float d_min_distance;
+};
+
+
+class constellation_bpsk_impl : public constellation_bpsk, public soft_demapper
 {
 public:
     constellation_bpsk_impl();
@@ -32,7 +61,7 @@ public:
 };
 
 
-class constellation_qpsk_impl : public constellation_qpsk
+class constellation_qpsk_impl : public constellation_qpsk, public soft_demapper
 {
 public:
     constellation_qpsk_impl();
@@ -42,7 +71,7 @@ public:
 };
 
 
-class constellation_16qam_impl : public constellation_16qam
+class constellation_16qam_impl : public constellation_16qam, public soft_demapper
 {
 public:
     constellation_16qam_impl();
@@ -52,7 +81,7 @@ public:
 };
 
 
-class constellation_64qam_impl : public constellation_64qam
+class constellation_64qam_impl : public constellation_64qam, public soft_demapper
 {
 public:
     constellation_64qam_impl();
@@ -62,6 +91,20 @@ public:
 };
 
 
+class constellation_256qam_impl : public constellation_256qam, public soft_demapper
+{
+public:
+    constellation_256qam_impl();
+    ~constellation_256qam_impl();
+
+    unsigned int decision_maker(const gr_complex* sample);
+
+private:
+    // amplitude of one axis for the upper three of its four bits
+    static const int LEVELS[8];
+};
+
+
 } // namespace ieee802_11
 } // namespace gr
 
@@ -16,12 +16,18 @@
  */
 #include <ieee802_11/decode_mac.h>
 
+#include "constellations_impl.h"
+#include "frame_modulator.h"
+#include "ldpc/ldpc_decoder.h"
 #include "utils.h"
 #include "viterbi_decoder/viterbi_decoder.h"
+#include "waveform_cache.h"
 
 #include <gnuradio/io_signature.h>
 #include <boost/crc.hpp>
+#include <chrono>
 #include <iomanip>
+#include <vector>
 
 using namespace gr::ieee802_11;
 
@@ -29,11 +35,23 @@ using namespace gr::ieee802_11;
 #define BYTE_SERVICE 1
 #define BYTE_CRC32 4
 
+// ACKs of the SIFS responder: frame control, duration, RA and FCS
+#define ACK_SIZE 14
+#define ACK_ENCODING BPSK_1_2
+// the waveforms are reused, so all ACKs share one scrambler seed
+#define ACK_SCRAMBLER 1
+// bytes of ACK waveforms kept, 16 transmitters at 25 symbols (about 8 kB) each
+#define ACK_CACHE_SIZE (16 * 8192)
+
 class decode_mac_impl : public decode_mac
 {
 
 public:
-    decode_mac_impl(bool log, bool debug)
+    decode_mac_impl(bool log,
+                    bool debug,
+                    bool sifs_ack,
+                    std::vector<uint8_t> src_mac,
+                    bool ndp_ack)
         : block("decode_mac",
                 gr::io_signature::make(1, 1, CODED_BITS_PER_OFDM_SYMBOL * sizeof(gr_complex)),
                 gr::io_signature::make(0, 0, 0)),
@@ -41,9 +59,33 @@ public:
           d_debug(debug),
           d_ofdm(BPSK_1_2),
           d_frame(d_ofdm, 0),
-          d_frame_complete(true)
+          d_frame_complete(true),
+          d_sifs_ack(sifs_ack),
+          d_ndp_ack(ndp_ack)
     {
         message_port_register_out(pmt::mp("out"));
+        message_port_register_out(pmt::mp("ack"));
+
+        if (src_mac.size() != 6) {
+            throw std::invalid_argument("MAC address has to consist of 6 bytes");
+        }
+        std::copy(src_mac.begin(), src_mac.end(), d_src_mac);
+
+        // the responder has no time to modulate, only NDP ACKs are few
+        // enough to be all computed up front
+        if (d_sifs_ack) {
+            d_modulator.reset(new frame_modulator(ACK_ENCODING));
+            d_acks.reset(new waveform_cache(ACK_CACHE_SIZE));
+        }
+        if (d_sifs_ack && d_ndp_ack) {
+            for (int id = 0; id < (1 << NDP_ACK_ID_BITS); id++) {
+                d_modulator->start_ndp(::ndp_ack(id));
+                d_ndp_acks.push_back(d_modulator->modulate());
+            }
+        }
+
+        dout << "Decode MAC: " << sizeof(decode_mac_impl) << " bytes per instance, "
+             << sizeof(viterbi_decoder) << " of them in the viterbi decoder" << std::endl;
     }
 
     int general_work(int noutput_items,
@@ -84,17 +126,39 @@ public:
                     d_meta, pmt::mp("frame bytes"), pmt::from_uint64(MAX_PSDU_SIZE + 1)));
                 int encoding = pmt::to_uint64(
                     pmt::dict_ref(d_meta, pmt::mp("encoding"), pmt::from_uint64(0)));
+                bool ldpc = pmt::to_bool(
+                    pmt::dict_ref(d_meta, pmt::mp("ldpc"), pmt::PMT_F));
+                bool aggregation = pmt::to_bool(
+                    pmt::dict_ref(d_meta, pmt::mp("aggregation"), pmt::PMT_F));
 
                 ofdm_param ofdm = ofdm_param((Encoding)encoding);
-                frame_param frame = frame_param(ofdm, len_data);
+                frame_param frame = frame_param(ofdm, len_data, ldpc, aggregation);
 
                 // check for maximum frame size
-                if (frame.n_sym <= MAX_SYM && frame.psdu_size <= MAX_PSDU_SIZE) {
+                int max_size = aggregation ? MAX_AMPDU_SIZE : MAX_PSDU_SIZE;
+                if (frame.n_sym <= MAX_SYM && frame.psdu_size <= max_size) {
                     d_ofdm = ofdm;
                     d_frame = frame;
                     copied = 0;
+                    if (ldpc) {
+                        // grown on demand, to the largest frame seen so far
+                        size_t n = frame.ldpc_params.n_avbits;
+                        if (d_llr.size() < n) {
+                            d_llr.resize(n);
+                            d_ldpc_bits.resize((n + 7) / 8);
+                        }
+                    } else {
+                        std::memset(
+                            d_soft_bits, 0, SOFT_BUFFER_SIZE(frame.n_encoded_bits));
+                    }
+                    d_demapper =
+                        std::dynamic_pointer_cast<soft_demapper>(ofdm.constellation);
+                    // LLRs reach +-1 on the nearest points of the weakest bit
+                    d_soft_scale = 1 / d_demapper->min_distance();
                     dout << "Decode MAC: frame start -- len " << len_data << "  symbols "
-                         << frame.n_sym << "  encoding " << encoding << std::endl;
+                         << frame.n_sym << "  encoding " << encoding
+                         << (ldpc ? "  LDPC" : "") << (aggregation ? "  A-MPDU" : "")
+                         << std::endl;
                 } else {
                     dout << "Dropping frame which is too large (symbols or bits)"
                          << std::endl;
@@ -106,8 +170,13 @@ public:
                 dout << "copy one symbol, copied " << copied << " out of "
                      << d_frame.n_sym << std::endl;
                 
+                //LDPC, soft bits straight from the tone demapper
+                if(d_frame.ldpc){
+                    soft_symbol(in);
+                }
+
                 //if MCS = 10
-                if(d_ofdm.encoding == gr::ieee802_11::BPSK_1_2_REP){
+                else if(d_ofdm.encoding == gr::ieee802_11::BPSK_1_2_REP){
                     
                     //deinterleave the complex symbols
                     gr_complex d_deinterleaved[CODED_BITS_PER_OFDM_SYMBOL];
@@ -116,37 +185,32 @@ public:
                     //unrepeat the complex symbols
                     unrepeat(d_unrepeated, d_deinterleaved);
 
-                    //bit decision last
+                    //soft bits last
                     for (int j = 0; j < d_ofdm.n_cbps; j++){
-                        d_rx_bits[j] = d_ofdm.constellation->decision_maker(&d_unrepeated[j]);
+                        soft_bits(d_unrepeated[j], d_rx_bits + j);
                     }
+                    store_symbol(d_rx_bits);
                 }
 
                 //for any other MCS
                 else{
                     
-                    //bit decision first
+                    //soft bits first
                     for (int j = 0; j < CODED_BITS_PER_OFDM_SYMBOL; j++){
-                        for(int k = 0; k < d_ofdm.n_bpsc; k++){
-                            d_rx_bits[j * d_ofdm.n_bpsc + k] = !!(d_ofdm.constellation->decision_maker(&in[j]) &(1 << k));
-                        }
+                        soft_bits(in[j], d_rx_bits + j * d_ofdm.n_bpsc);
                     }
 
-                    //deinterleave the bits
+                    //deinterleave the soft bits
                     uint8_t d_deinterleaved[MAX_BITS_PER_SYM];
                     deinterleave(d_rx_bits, d_deinterleaved, d_frame, d_ofdm);
-                    
-                    //copy deinterleaved bits back into d_rx_bits
-                    memcpy(d_rx_bits, d_deinterleaved, d_ofdm.n_cbps * sizeof(uint8_t));
+                    store_symbol(d_deinterleaved);
                 }
 
-                //copy d_rx_bits into d_encoded_bits for future conv decoding
-                memcpy(d_encoded_bits + copied * d_ofdm.n_cbps, d_rx_bits, d_ofdm.n_cbps);
-
                 copied++;
 
                 if (copied == d_frame.n_sym) {
                     dout << "received complete frame - decoding" << std::endl;
+                    d_last_symbol = std::chrono::steady_clock::now();
                     decode();
                     in += CODED_BITS_PER_OFDM_SYMBOL;
                     i++;
@@ -167,52 +231,230 @@ public:
     void decode()
     {   
 
+        if (d_frame.ldpc) {
+            bool ok = d_ldpc_decoder.decode(
+                d_llr.data(), d_ldpc_bits.data(), d_frame.ldpc_params);
+            dout << "LDPC: " << d_ldpc_decoder.iterations() << " iterations"
+                 << (ok ? "" : ", not converged") << std::endl;
+
+            descramble(d_ldpc_bits.data());
+            finish_frame();
+            return;
+        }
+
         //round n_data_bits to superior and closest multiple of 8 (viterbi algorithm works byte per byte)
         d_frame.n_data_bits  += 7;
-        d_frame.n_data_bits  &= 0xfff8;
+        d_frame.n_data_bits  &= ~7;
 
 
         if(d_frame.n_data_bits % 8 != 0){
             dout << "ERROR : n data bits should be a multiple of 8 ! " << std::endl;
         }
         
-        uint8_t* decoded = d_decoder.decode(&d_ofdm, &d_frame, d_encoded_bits);
+        uint8_t* decoded = d_decoder.decode(&d_ofdm, &d_frame, d_soft_bits);
 
         descramble(decoded);
 
+        finish_frame();
+    }
 
+    // publishes the MPDU, or every MPDU of an A-MPDU, of the descrambled frame
+    void finish_frame()
+    {
         print_output();
 
-        // skip service field
+        const uint8_t* psdu = out_bytes + BYTE_SERVICE;
+        if (!d_frame.aggregation) {
+            publish_mpdu(psdu, d_frame.psdu_size);
+            return;
+        }
+
+        // the subframes are checked one by one, a corrupted MPDU costs only
+        // itself and a broken delimiter is skipped until the next valid one
+        int pos = 0;
+        int received = 0;
+        int lost = 0;
+        while (pos + AMPDU_DELIMITER_SIZE <= d_frame.psdu_size) {
+            const uint8_t* delimiter = psdu + pos;
+            int len = ampdu_mpdu_length(delimiter);
+            pos += AMPDU_DELIMITER_SIZE;
+
+            // resync, delimiters start at multiples of four octets
+            if (len < 0) {
+                continue;
+            }
+
+            bool eof = delimiter[0] & 1;
+            if (len > 0) {
+                if (pos + len > d_frame.psdu_size) {
+                    dout << "A-MPDU: subframe of " << len << " bytes exceeds the PSDU"
+                         << std::endl;
+                    lost++;
+                    break;
+                }
+                if (publish_mpdu(psdu + pos, len)) {
+                    received++;
+                } else {
+                    lost++;
+                }
+                pos += (len + 3) & ~3;
+            }
+
+            // the rest is EOF padding
+            if (eof) {
+                break;
+            }
+        }
+
+        dout << "A-MPDU: " << received << " MPDUs received, " << lost << " lost"
+             << std::endl;
+    }
+
+    // checks the FCS of one MPDU and publishes it without the FCS
+    bool publish_mpdu(const uint8_t* mpdu, int len)
+    {
+        if (len < BYTE_CRC32) {
+            return false;
+        }
+
         boost::crc_32_type result;
-        result.process_bytes(out_bytes + BYTE_SERVICE, d_frame.psdu_size);
+        result.process_bytes(mpdu, len);
         if (result.checksum() != 558161692) {
             dout << "checksum wrong -- dropping. expected 558161692 got: " << result.checksum() << std::endl;
-            return;
+            return false;
+        }
+
+        // the ACK goes first, everything else can wait
+        if (d_sifs_ack && !d_frame.aggregation) {
+            respond(mpdu, len);
         }
 
         mylog("encoding: {} - length: {} - symbols: {}",
               d_ofdm.encoding,
-              d_frame.psdu_size,
+              len,
               d_frame.n_sym);
 
         // create PDU
-        pmt::pmt_t blob = pmt::make_blob(out_bytes + BYTE_SERVICE, d_frame.psdu_size - BYTE_CRC32);
+        pmt::pmt_t blob = pmt::make_blob(mpdu, len - BYTE_CRC32);
         d_meta =
             pmt::dict_add(d_meta, pmt::mp("dlt"), pmt::from_long(LINKTYPE_IEEE802_11));
 
         message_port_pub(pmt::mp("out"), pmt::cons(d_meta, blob));
+        return true;
+    }
+
+    // acknowledges unicast data and management frames to src_mac, len with FCS
+    void respond(const uint8_t* mpdu, int len)
+    {
+        // legacy header up to the TA, control frames are never acknowledged
+        if (len < 16 + BYTE_CRC32 || (mpdu[0] & 0x03) != 0 || (mpdu[0] & 0x0c) == 0x04 ||
+            !std::equal(d_src_mac, d_src_mac + 6, mpdu + 4)) {
+            return;
+        }
+
+        waveform_cache::samples_ptr samples;
+        if (d_ndp_ack) {
+            samples = d_ndp_acks[ndp_ack_id(mpdu, len - BYTE_CRC32)];
+        } else {
+            samples = ack_waveform(mpdu + 10);
+        }
+
+        pmt::pmt_t dict = pmt::make_dict();
+        pmt::pmt_t rx_time = pmt::dict_ref(d_meta, pmt::mp("rx time"), pmt::PMT_NIL);
+        if (pmt::is_tuple(rx_time)) {
+            dict = pmt::dict_add(dict,
+                                 pmt::mp("tx_time"),
+                                 timestamp_add(rx_time, ppdu_samples() + SIFS_SAMPLES));
+        }
 
+        // time since the last DATA symbol came in, at the sample rate
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - d_last_symbol;
+        long turnaround = std::lround(elapsed.count() * SAMPLE_RATE);
+        dict = pmt::dict_add(dict, pmt::mp("turnaround"), pmt::from_long(turnaround));
+
+        message_port_pub(pmt::mp("ack"),
+                         pmt::cons(dict, pmt::init_c32vector(samples->size(), *samples)));
+
+        mylog("SIFS responder: {} after {} samples, SIFS is {}",
+              d_ndp_ack ? "NDP ACK" : "ACK",
+              turnaround,
+              SIFS_SAMPLES);
     }
 
-    void descramble(uint8_t* decoded_bits)
+    // samples of the ACK to ra, modulated on the first frame from ra
+    waveform_cache::samples_ptr ack_waveform(const uint8_t* ra)
+    {
+        uint8_t ack[ACK_SIZE] = { 0xd4, 0x00, 0x00, 0x00 };
+        std::memcpy(ack + 4, ra, 6);
+        boost::crc_32_type result;
+        result.process_bytes(ack, ACK_SIZE - BYTE_CRC32);
+        uint32_t fcs = result.checksum();
+        std::memcpy(ack + ACK_SIZE - BYTE_CRC32, &fcs, sizeof(uint32_t));
+
+        const char* psdu = reinterpret_cast<const char*>(ack);
+        waveform_cache::samples_ptr samples =
+            d_acks->lookup(psdu, ACK_SIZE, ACK_ENCODING, ACK_SCRAMBLER);
+        if (!samples) {
+            frame_param frame(d_modulator->ofdm(), ACK_SIZE);
+            d_modulator->start_frame(psdu, ACK_SIZE, frame, ACK_SCRAMBLER, false);
+            samples = d_modulator->modulate();
+            d_acks->insert(psdu, ACK_SIZE, ACK_ENCODING, ACK_SCRAMBLER, samples);
+        }
+        return samples;
+    }
+
+    // samples from the first LTS to the end of the current PPDU
+    int ppdu_samples()
+    {
+        bool short_gi =
+            pmt::to_bool(pmt::dict_ref(d_meta, pmt::mp("short gi"), pmt::PMT_F));
+        int n = DATA_FIELD_START +
+                d_frame.n_sym * (SAMPLES_PER_OFDM_SYMBOL + SAMPLES_PER_GI);
+        if (short_gi) {
+            n -= (d_frame.n_sym - 1) * (SAMPLES_PER_GI - SAMPLES_PER_SHORT_GI);
+        }
+        return n;
+    }
+
+    // append the soft bits of one symbol to the packed frame buffer
+    void store_symbol(const uint8_t* bits)
+    {
+        int offset = copied * d_ofdm.n_cbps;
+        for (int j = 0; j < d_ofdm.n_cbps; j++) {
+            SET_SOFT_BIT(d_soft_bits, offset + j, bits[j]);
+        }
+    }
+
+    // max-log LLRs of one LDPC coded symbol
+    void soft_symbol(const gr_complex* in)
+    {
+        float* llr = d_llr.data() + copied * d_ofdm.n_cbps;
+        for (int k = 0; k < CODED_BITS_PER_OFDM_SYMBOL; k++) {
+            // no interleaver, the tone mapper spreads the points instead
+            d_demapper->demap(in[ldpc_tone(k)], llr + k * d_ofdm.n_bpsc);
+        }
+    }
+
+    // soft bits of one point for the Viterbi decoder, 0 is a sure 0
+    void soft_bits(const gr_complex& y, uint8_t* bits)
+    {
+        float llr[MAX_BITS_PER_SYM / CODED_BITS_PER_OFDM_SYMBOL];
+        d_demapper->demap(y, llr);
+        for (int b = 0; b < d_ofdm.n_bpsc; b++) {
+            float s = SOFT_MAX / 2.0f * (1 - llr[b] * d_soft_scale);
+            bits[b] = std::min(std::max(std::lround(s), 0L), long(SOFT_MAX));
+        }
+    }
+
+    void descramble(const uint8_t* decoded_bits)
     {
 
         int state = 0;
         std::memset(out_bytes, 0, d_frame.psdu_size + BYTE_SERVICE);
 
         for (int i = 0; i < 7; i++) {
-            if (decoded_bits[i]) {
+            if (GET_PACKED_BIT(decoded_bits, i)) {
                 state |= 1 << (6 - i);
             }
         }
@@ -223,7 +465,7 @@ public:
 
         for (int i = 7; i < d_frame.psdu_size * 8 + 8; i++) {
             feedback = ((!!(state & 64))) ^ (!!(state & 8));
-            bit = feedback ^ (decoded_bits[i] & 0x1);
+            bit = feedback ^ GET_PACKED_BIT(decoded_bits, i);
             out_bytes[i / 8] |= bit << (i % 8);
             state = ((state << 1) & 0x7e) | feedback;
         }
@@ -262,21 +504,36 @@ private:
     ofdm_param d_ofdm;
 
     viterbi_decoder d_decoder;
+    ldpc_decoder d_ldpc_decoder;
 
-    gr_complex *d_rx_symbols;
-    uint8_t d_rx_bits[MAX_ENCODED_BITS];
+    uint8_t d_rx_bits[MAX_BITS_PER_SYM]; // soft bits of the current symbol
 
-    uint8_t out_bytes[MAX_PSDU_SIZE + 6]; // 2 for signal field
+    uint8_t out_bytes[MAX_AMPDU_SIZE + 6]; // 2 for signal field
 
     //gr_complex d_deinterleaved[CODED_BITS_PER_OFDM_SYMBOL];
     gr_complex d_unrepeated[NUM_BITS_UNREPEATED_SIG_SYMBOL];
-    uint8_t d_encoded_bits[MAX_ENCODED_BITS] = {0};
+    uint8_t d_soft_bits[SOFT_BUFFER_SIZE(MAX_ENCODED_BITS)] = {0}; // BCC, packed
+    std::shared_ptr<soft_demapper> d_demapper; // of the current frame
+    float d_soft_scale;                // LLR to soft bit, by the constellation
+    std::vector<float> d_llr;          // soft bits of LDPC frames
+    std::vector<uint8_t> d_ldpc_bits;  // decoded, packed
 
     int copied;
     bool d_frame_complete;
+
+    // SIFS responder
+    bool d_sifs_ack;
+    uint8_t d_src_mac[6];
+    bool d_ndp_ack;
+    std::unique_ptr<frame_modulator> d_modulator;
+    std::unique_ptr<waveform_cache> d_acks;           // ACK per transmitter
+    std::vector<waveform_cache::samples_ptr> d_ndp_acks; // NDP ACK per Ack ID
+    std::chrono::steady_clock::time_point d_last_symbol;
 };
 
-decode_mac::sptr decode_mac::make(bool log, bool debug)
+decode_mac::sptr decode_mac::make(
+    bool log, bool debug, bool sifs_ack, std::vector<uint8_t> src_mac, bool ndp_ack)
 {
-    return gnuradio::get_initial_sptr(new decode_mac_impl(log, debug));
+    return gnuradio::get_initial_sptr(
+        new decode_mac_impl(log, debug, sifs_ack, src_mac, ndp_ack));
 }
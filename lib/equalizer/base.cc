@@ -19,6 +19,7 @@
 #include <cstring>
 #include <iostream>
 
+using namespace gr::ieee802_11;
 using namespace gr::ieee802_11::equalizer;
 
 const gr_complex base::LONG[] = { 0,  0,  0,  1, -1,  1, -1, -1,  1, -1, 1, 1, -1, 1, 1, 1, 0, -1, -1, -1, 1, -1, -1, -1, 1, -1, 1, 1, 1, -1, 0, 0};
@@ -46,9 +47,9 @@ const gr_complex base::POLARITY[127] = {
 std::vector<gr_complex> base::get_csi()
 {
     std::vector<gr_complex> csi;
-    csi.reserve(26);
+    csi.reserve(halow_1mhz::DATA_CARRIERS + halow_1mhz::PILOTS);
     for (int i = 0; i < SAMPLES_PER_OFDM_SYMBOL; i++) {
-        if ((i == 16) || (i < 3) || (i > 29)) {
+        if (is_null_subcarrier<halow_1mhz>(i)) {
             continue;
         }
         csi.push_back(d_H[i]);
@@ -58,7 +59,7 @@ std::vector<gr_complex> base::get_csi()
 
 gr_complex base::get_csi_at(int subcarrier_index)
 {
-    if ((subcarrier_index == 16) || (subcarrier_index < 3) || (subcarrier_index > 29)) {
+    if (is_null_subcarrier<halow_1mhz>(subcarrier_index)) {
         return gr_complex(0,0);
     }
     else{
@@ -19,6 +19,7 @@
 #include <cstring>
 #include <iostream>
 
+using namespace gr::ieee802_11;
 using namespace gr::ieee802_11::equalizer;
 
 void ls::equalize(gr_complex* in,
@@ -72,7 +73,7 @@ void ls::equalize(gr_complex* in,
         double noise = 0;
 
         for (int i = 0; i < SAMPLES_PER_OFDM_SYMBOL; i++) {
-            if ((i == 16) || (i < 3) || (i > 29)) {
+            if (is_null_subcarrier<halow_1mhz>(i)) {
                 continue;//skip if dead subcarrier
             }
             d_H[i] *= gr_complex((float) n / (n + 1), 0);//rescale current mean iaw previous and current mean sizes
@@ -103,8 +104,8 @@ void ls::equalize(gr_complex* in,
     else {
         int c = 0;
         for (int i = 0; i < SAMPLES_PER_OFDM_SYMBOL; i++) {
-            if ((i == pilot1_index) || (i == 16) || (i == pilot2_index) ||
-                (i < 3) || (i > 29)) {
+            if ((i == pilot1_index) || (i == pilot2_index) ||
+                is_null_subcarrier<halow_1mhz>(i)) {
                 continue; //ignore all pilots and dead subcarriers
             } else {
                 symbols[c] = in[i] / d_H[i];
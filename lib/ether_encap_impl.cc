@@ -19,17 +19,25 @@
 
 #include <gnuradio/block_detail.h>
 #include <gnuradio/io_signature.h>
+#include <stdexcept>
 #include <string>
 
 using namespace gr::ieee802_11;
 
-ether_encap_impl::ether_encap_impl(bool debug)
+ether_encap_impl::ether_encap_impl(bool debug,
+                                   bool short_header,
+                                   std::vector<uint8_t> sta_mac)
     : block("ether_encap",
             gr::io_signature::make(0, 0, 0),
             gr::io_signature::make(0, 0, 0)),
       d_debug(debug),
-      d_last_seq(123)
+      d_last_seq(123),
+      d_short_header(short_header)
 {
+    if (sta_mac.size() != 6) {
+        throw std::invalid_argument("wrong mac address size");
+    }
+    std::copy(sta_mac.begin(), sta_mac.end(), d_sta_mac);
 
     message_port_register_out(pmt::mp("to tap"));
     message_port_register_out(pmt::mp("to wifi"));
@@ -52,6 +60,11 @@ void ether_encap_impl::from_wifi(pmt::pmt_t msg)
     int data_len = pmt::blob_length(msg);
     const mac_header* mhdr = reinterpret_cast<const mac_header*>(pmt::blob_data(msg));
 
+    if (data_len >= 2 && (mhdr->frame_control & 3) == PV1_VERSION) {
+        from_wifi_pv1(reinterpret_cast<const uint8_t*>(mhdr), data_len);
+        return;
+    }
+
     if (d_last_seq == mhdr->seq_nr) {
         dout << "Ether Encap: frame already seen -- skipping" << std::endl;
         return;
@@ -97,6 +110,48 @@ void ether_encap_impl::from_wifi(pmt::pmt_t msg)
     free(buf);
 }
 
+void ether_encap_impl::from_wifi_pv1(const uint8_t* frame, int data_len)
+{
+    if (!d_short_header) {
+        dout << "Ether Encap: short MAC header -- ignoring" << std::endl;
+        return;
+    }
+
+    pv1_header h;
+    if (!parse_pv1_header(frame, data_len, h)) {
+        dout << "this is not a PV1 data frame -- ignoring" << std::endl;
+        return;
+    }
+
+    if (d_last_seq == h.seq_nr) {
+        dout << "Ether Encap: frame already seen -- skipping" << std::endl;
+        return;
+    }
+
+    d_last_seq = h.seq_nr;
+
+    // header and LLC/SNAP
+    int offset = h.size + 8;
+    if (data_len <= offset) {
+        dout << "Ether Encap: frame too short to parse" << std::endl;
+        return;
+    }
+
+    char* buf = static_cast<char*>(std::malloc(data_len - offset + sizeof(ethernet_header)));
+    ethernet_header* ehdr = reinterpret_cast<ethernet_header*>(buf);
+
+    // the SID stands for the station, the other address is the BSSID
+    std::memcpy(ehdr->dest, h.from_ds ? d_sta_mac : h.bssid, 6);
+    std::memcpy(ehdr->src, h.from_ds ? h.bssid : d_sta_mac, 6);
+    ehdr->type = 0x0008;
+
+    memcpy(buf + sizeof(ethernet_header), frame + offset, data_len - offset);
+    pmt::pmt_t payload = pmt::make_blob(buf, data_len - offset + sizeof(ethernet_header));
+    message_port_pub(pmt::mp("to tap"), pmt::cons(pmt::PMT_NIL, payload));
+
+    free(buf);
+}
+
 void ether_encap_impl::from_tap(pmt::pmt_t msg)
 {
     size_t len = pmt::blob_length(pmt::cdr(msg));
@@ -132,7 +187,8 @@ void ether_encap_impl::from_tap(pmt::pmt_t msg)
     }
 }
 
-ether_encap::sptr ether_encap::make(bool debug)
+ether_encap::sptr
+ether_encap::make(bool debug, bool short_header, std::vector<uint8_t> sta_mac)
 {
-    return gnuradio::get_initial_sptr(new ether_encap_impl(debug));
+    return gnuradio::get_initial_sptr(new ether_encap_impl(debug, short_header, sta_mac));
 }
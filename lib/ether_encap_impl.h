@@ -34,14 +34,18 @@ class ether_encap_impl : public ether_encap
 {
 
 public:
-    ether_encap_impl(bool debug);
+    ether_encap_impl(bool debug, bool short_header, std::vector<uint8_t> sta_mac);
 
 private:
     void from_tap(pmt::pmt_t msg);
     void from_wifi(pmt::pmt_t msg);
+    void from_wifi_pv1(const uint8_t* frame, int data_len);
 
     bool d_debug;
     uint16_t d_last_seq;
+    bool d_short_header;
+    // MAC address of the station the AID of PV1 frames stands for
+    uint8_t d_sta_mac[6];
 };
 
 } // namespace ieee802_11
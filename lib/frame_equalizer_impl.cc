@@ -48,10 +48,19 @@ frame_equalizer_impl::frame_equalizer_impl(
       d_bw(bw),
       d_frame_bytes(0),
       d_frame_symbols(0),
-      d_freq_offset_from_synclong(0.0)
+      d_freq_offset_from_synclong(0.0),
+      d_frame_start(0),
+      d_short_gi(false),
+      d_ldpc(false),
+      d_aggregation(false),
+      d_ndp(false),
+      d_ndp_body(0),
+      d_rx_time(pmt::PMT_NIL)
 {
 
     message_port_register_out(pmt::mp("symbols"));
+    message_port_register_out(pmt::mp("gi"));
+    message_port_register_out(pmt::mp("ndp"));
 
     d_bpsk = constellation_bpsk::make();
     d_qpsk = constellation_qpsk::make();
@@ -144,7 +153,15 @@ int frame_equalizer_impl::general_work(int noutput_items,
             d_frame_symbols = 0;
             d_sig = 0;
             d_travel_pilots = false;
+            d_short_gi = false;
+            d_ldpc = false;
+            d_aggregation = false;
+            d_ndp = false;
             d_frame_mod = d_bpsk;
+            d_frame_start = tags.front().offset;
+
+            get_tags_in_window(tags, 0, i, i + 1, pmt::mp("rx time"));
+            d_rx_time = tags.size() ? tags.front().value : pmt::PMT_NIL;
 
             d_freq_offset_from_synclong =
                 pmt::to_double(tags.front().value) * d_bw / (2 * M_PI);
@@ -155,7 +172,8 @@ int frame_equalizer_impl::general_work(int noutput_items,
         }
 
         // if we reached the end of the frame, drop remaining samples
-        if (d_current_symbol > (d_frame_symbols + NUM_OFDM_SYMBOLS_IN_LTF1 + NUM_OFDM_SYMBOLS_IN_SIG_FIELD)) {
+        if (d_current_symbol > (d_frame_symbols + NUM_OFDM_SYMBOLS_IN_LTF1 + NUM_OFDM_SYMBOLS_IN_SIG_FIELD) ||
+            (d_ndp && d_current_symbol >= NUM_OFDM_SYMBOLS_IN_LTF1 + NUM_OFDM_SYMBOLS_IN_SIG_FIELD)) {
             i++;
             continue;
         }
@@ -198,7 +216,7 @@ int frame_equalizer_impl::general_work(int noutput_items,
         // compensate sampling offset        
         for (int i = 0; i < SAMPLES_PER_OFDM_SYMBOL; i++) {
             current_symbol[i] *= exp(gr_complex(0,
-                                                - 2 * M_PI * d_current_symbol * (SAMPLES_PER_OFDM_SYMBOL + SAMPLES_PER_GI) * 
+                                                - 2 * M_PI * symbol_time(d_current_symbol) * 
                                                     (d_epsilon0 + d_er) * (i - SAMPLES_PER_OFDM_SYMBOL / 2) / SAMPLES_PER_OFDM_SYMBOL));
             
             //@irongiant33 To answer your question "what is 32? Half of the 802.11a number of subcarriers?". The "32" seem indeed to come from the number of subcarriers in 802.11a. The sampling offset compensation performed is described in Equation 7 of paper "Frequency Offset Estimation and Correction in the IEEE 802.11a WLAN" (see https://openofdm.readthedocs.io/en/latest/_downloads/vtc04_freq_offset.pdf). The number (i - 32) actually corresponds to the k variable that ranges from -26 to 26. Consequently, you should replace "32" with "SAMPLES_PER_OFDM_SYMBOL/2" in your code.
@@ -228,7 +246,7 @@ int frame_equalizer_impl::general_work(int noutput_items,
         double er = arg((conj(d_prev_pilots_with_corrected_polarity[0]) * pilot_mapping[0] * current_symbol[pilot1_index]) +
                         (conj(d_prev_pilots_with_corrected_polarity[1]) * pilot_mapping[1] * current_symbol[pilot2_index]));
 
-        er *= d_bw / (2 * M_PI * d_freq * (SAMPLES_PER_OFDM_SYMBOL + SAMPLES_PER_GI));
+        er *= d_bw / (2 * M_PI * d_freq * (symbol_time(d_current_symbol + 1) - symbol_time(d_current_symbol)));
 
         // compensate residual frequency offset iaw Equation (9)
         for (int i = 0; i < SAMPLES_PER_OFDM_SYMBOL; i++) {
@@ -253,13 +271,33 @@ int frame_equalizer_impl::general_work(int noutput_items,
         if (d_current_symbol >= NUM_OFDM_SYMBOLS_IN_LTF1 && d_current_symbol < NUM_OFDM_SYMBOLS_IN_LTF1 + NUM_OFDM_SYMBOLS_IN_SIG_FIELD){
             dout << "o: " << o << std::endl;
 
-            if (decode_signal_field(symbols)) {
+            bool valid = decode_signal_field(symbols);
+
+            // sync_long holds the DATA field back until it knows the GI
+            if (d_sig == NUM_OFDM_SYMBOLS_IN_SIG_FIELD) {
+                message_port_pub(pmt::mp("gi"),
+                                 pmt::cons(pmt::from_uint64(d_frame_start),
+                                           pmt::from_bool(valid && d_short_gi)));
+            }
+
+            // NDPs end here, they go out as PDUs and not to decode_mac
+            if (valid && d_ndp) {
+                publish_ndp(beta);
+            } else if (valid) {
 
                 pmt::pmt_t dict = pmt::make_dict();
                 dict = pmt::dict_add(
                     dict, pmt::mp("frame bytes"), pmt::from_uint64(d_frame_bytes));
                 dict = pmt::dict_add(
                     dict, pmt::mp("encoding"), pmt::from_uint64(d_frame_encoding));
+                dict = pmt::dict_add(dict, pmt::mp("ldpc"), pmt::from_bool(d_ldpc));
+                dict = pmt::dict_add(
+                    dict, pmt::mp("aggregation"), pmt::from_bool(d_aggregation));
+                dict = pmt::dict_add(dict, pmt::mp("short gi"), pmt::from_bool(d_short_gi));
+                // sample clock time of the first LTF symbol
+                if (pmt::is_tuple(d_rx_time)) {
+                    dict = pmt::dict_add(dict, pmt::mp("rx time"), d_rx_time);
+                }
                 dict = pmt::dict_add(
                     dict, pmt::mp("snr"), pmt::from_double(d_equalizer->get_snr()));
                 dict = pmt::dict_add(
@@ -302,20 +340,72 @@ int frame_equalizer_impl::general_work(int noutput_items,
     return o;
 }
 
+void frame_equalizer_impl::publish_ndp(double beta)
+{
+    pmt::pmt_t dict = pmt::make_dict();
+    dict = pmt::dict_add(dict, pmt::mp("ndp"), pmt::from_long(d_ndp_body));
+
+    int type = ndp_field(d_ndp_body, 0, 3);
+    switch (type) {
+    case NDP_CTS:
+        dict = pmt::dict_add(dict, pmt::mp("ndp type"), pmt::mp("CTS"));
+        dict = pmt::dict_add(
+            dict, pmt::mp("duration"), pmt::from_long(ndp_field(d_ndp_body, 13, 10)));
+        break;
+    case NDP_PS_POLL:
+        dict = pmt::dict_add(dict, pmt::mp("ndp type"), pmt::mp("PS-Poll"));
+        dict = pmt::dict_add(
+            dict, pmt::mp("aid"), pmt::from_long(ndp_field(d_ndp_body, 12, 13)));
+        break;
+    case NDP_ACK:
+        dict = pmt::dict_add(dict, pmt::mp("ndp type"), pmt::mp("ACK"));
+        dict = pmt::dict_add(dict,
+                             pmt::mp("ack id"),
+                             pmt::from_long(ndp_field(d_ndp_body, 3, NDP_ACK_ID_BITS)));
+        dict = pmt::dict_add(
+            dict, pmt::mp("duration"), pmt::from_long(ndp_field(d_ndp_body, 14, 10)));
+        break;
+    default:
+        dict = pmt::dict_add(dict, pmt::mp("ndp type"), pmt::from_long(type));
+        break;
+    }
+
+    if (pmt::is_tuple(d_rx_time)) {
+        dict = pmt::dict_add(dict, pmt::mp("rx time"), d_rx_time);
+    }
+    dict = pmt::dict_add(dict, pmt::mp("snr"), pmt::from_double(d_equalizer->get_snr()));
+    dict = pmt::dict_add(dict, pmt::mp("nominal frequency"), pmt::from_double(d_freq));
+    dict = pmt::dict_add(
+        dict, pmt::mp("frequency offset"), pmt::from_double(d_freq_offset_from_synclong));
+    dict = pmt::dict_add(dict, pmt::mp("beta"), pmt::from_double(beta));
+
+    mylog("NDP: {:#x}", d_ndp_body);
+    message_port_pub(pmt::mp("ndp"), pmt::cons(dict, pmt::make_blob(nullptr, 0)));
+}
+
+// start of the symbol in samples, relative to the first LTS; with short GI,
+// every DATA symbol after the first one is 4 samples shorter
+double frame_equalizer_impl::symbol_time(int symbol)
+{
+    double t = symbol * (SAMPLES_PER_OFDM_SYMBOL + SAMPLES_PER_GI);
+    int first_data = NUM_OFDM_SYMBOLS_IN_LTF1 + NUM_OFDM_SYMBOLS_IN_SIG_FIELD;
+    if (d_short_gi && symbol > first_data) {
+        t -= (symbol - first_data) * (SAMPLES_PER_GI - SAMPLES_PER_SHORT_GI);
+    }
+    return t;
+}
+
 bool frame_equalizer_impl::decode_signal_field(gr_complex* rx_symbols)
 {
-    static ofdm_param ofdm(BPSK_1_2_REP);
-    static frame_param frame(ofdm);
-    
     //deinterleave
     deinterleave(d_deinterleaved, rx_symbols);
 
     //unrepeat
     unrepeat(d_unrepeated, d_deinterleaved);
 
-    //add the decided bit into d_sig_field_bits
+    //keep the combined soft bits, the sig decoder works on soft decisions
     for (int i = 0; i < NUM_BITS_UNREPEATED_SIG_SYMBOL; i++){
-        d_sig_field_bits[d_sig * NUM_BITS_UNREPEATED_SIG_SYMBOL + i] = ofdm.constellation->decision_maker(&d_unrepeated[i]);
+        d_sig_field_soft[d_sig * NUM_BITS_UNREPEATED_SIG_SYMBOL + i] = d_unrepeated[i].real();
     }
 
     //increment the sig number
@@ -325,8 +415,8 @@ bool frame_equalizer_impl::decode_signal_field(gr_complex* rx_symbols)
     if(d_sig == NUM_OFDM_SYMBOLS_IN_SIG_FIELD){
 
         //decode
-        uint8_t* decoded_bits = d_decoder.decode(&ofdm, &frame, d_sig_field_bits);
-        
+        const uint8_t* decoded_bits = d_sig_decoder.decode(d_sig_field_soft);
+
         //parse the sig field
         return parse_signal(decoded_bits);
     }
@@ -351,7 +441,7 @@ void frame_equalizer_impl::print_coding(frame_coding coding){
 }
 
 
-bool frame_equalizer_impl::parse_signal(uint8_t* decoded_bits)
+bool frame_equalizer_impl::parse_signal(const uint8_t* decoded_bits)
 {    
 
     //number of spatial streams
@@ -362,10 +452,10 @@ bool frame_equalizer_impl::parse_signal(uint8_t* decoded_bits)
 
     //coding
     frame_coding coding = decoded_bits[3] == 1 ? frame_coding::LDPC : frame_coding::BCC;
-    if(coding == frame_coding::LDPC){
-        dout << "ERROR : frame coding (LDPC) unsupported" << std::endl;
-    }
-    
+
+    //LDPC extra OFDM symbol
+    bool ldpc_extra = decoded_bits[4] == 1 ? true : false;
+
     //mcs
     uint8_t mcs = decoded_bits[7] * 0x1 + decoded_bits[8] * 0x2 + decoded_bits[9] * 0x4 + decoded_bits[10] * 0x8;
     d_frame_encoding = mcs;
@@ -376,15 +466,7 @@ bool frame_equalizer_impl::parse_signal(uint8_t* decoded_bits)
     //length
     uint16_t length = 0;
     for (int i = 0; i < 9; i++){
-        //length += decoded_bits[i] * pow(2, (20 - i));
-        length += decoded_bits[12 + i] * pow(2, i);
-    }
-    if(!aggregation){
-        //when Aggregation is set to OFF, length is the number of octets in the PSDU (Table 23-18)
-        d_frame_bytes = length;
-    }
-    else{
-        //TODO
+        length |= decoded_bits[12 + i] << i;
     }
 
     //travelling pilots
@@ -402,15 +484,17 @@ bool frame_equalizer_impl::parse_signal(uint8_t* decoded_bits)
     dout << "Coding : ";
     print_coding(coding);
     dout << std::endl;
+    dout << "LDPC extra symbol : " << ldpc_extra << std::endl;
     dout << "mcs : " << unsigned(mcs) << std::endl;
     dout << "Aggregation : " << aggregation << std::endl;
     dout << "length : " << unsigned(length) << std::endl;
     dout << "Travelling Pilots " << d_travel_pilots << std::endl;
     dout << "NDP Indication " << ndp << std::endl;
     dout << "CRC-4 bit received : " << unsigned(rx_crc4) << std::endl;
-    dout << "CRC-4 bit computed : " << unsigned(compute_crc(decoded_bits)) << std::endl;
+    uint8_t crc4 = compute_crc(decoded_bits);
+    dout << "CRC-4 bit computed : " << unsigned(crc4) << std::endl;
 
-    if(rx_crc4 == compute_crc(decoded_bits)){
+    if(rx_crc4 == crc4){
         dout << "SIG field read with success" << std::endl;
     }
     else{
@@ -419,13 +503,47 @@ bool frame_equalizer_impl::parse_signal(uint8_t* decoded_bits)
         return false;
     }
 
+    //an NDP has no DATA field, B0-B24 are its frame body
+    if(ndp){
+        d_ndp = true;
+        d_ndp_body = 0;
+        for (int i = 0; i < NDP_BODY_BITS; i++){
+            d_ndp_body |= uint32_t(decoded_bits[i]) << i;
+        }
+        d_frame_symbols = 0;
+        d_short_gi = false;
+        d_travel_pilots = false;
+        return true;
+    }
+
+    //there are no LDPC parameters for MCS10 and the reserved values
+    if(coding == frame_coding::LDPC && mcs >= BPSK_1_2_REP){
+        dout << "ERROR : no LDPC coding for MCS " << unsigned(mcs) << std::endl;
+        return false;
+    }
+
     //compute frame symbols, encoding and bytes members
     ofdm_param ofdm((gr::ieee802_11::Encoding) mcs);
-    frame_param frame(ofdm, (int)length);
+
+    //when Aggregation is set to OFF, length is the number of octets in the PSDU,
+    //otherwise the number of symbols and the A-MPDU fills all of them (Table 23-18)
+    int psdu_length = length;
+    if(aggregation){
+        psdu_length = ampdu_psdu_length(ofdm, length, coding == frame_coding::LDPC, ldpc_extra);
+    }
+    frame_param frame(ofdm, psdu_length, coding == frame_coding::LDPC, aggregation);
+
+    if(frame.ldpc && frame.ldpc_params.extra != ldpc_extra){
+        dout << "ERROR : LDPC extra symbol bit does not match the length" << std::endl;
+        return false;
+    }
 
     d_frame_symbols = frame.n_sym;
     d_frame_encoding = (int) mcs;
-    d_frame_bytes = (int)length;
+    d_short_gi = short_gi;
+    d_ldpc = frame.ldpc;
+    d_aggregation = aggregation;
+    d_frame_bytes = psdu_length;
 
     
     switch (mcs) {//table 23-41
@@ -453,6 +571,12 @@ bool frame_equalizer_impl::parse_signal(uint8_t* decoded_bits)
     case 7:
         dout << "Encoding: 3000 kbit/s   ";
         break;
+    case 8:
+        dout << "Encoding: 3600 kbit/s   ";
+        break;
+    case 9:
+        dout << "Encoding: 4000 kbit/s   ";
+        break;
     case 10:
         dout << "Encoding: 150 kbit/s   ";
         break;
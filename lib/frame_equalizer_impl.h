@@ -19,7 +19,7 @@
 #define INCLUDED_IEEE802_11_FRAME_EQUALIZER_IMPL_H
 
 #include "equalizer/base.h"
-#include "viterbi_decoder/viterbi_decoder.h"
+#include "viterbi_decoder/sig_decoder.h"
 #include <ieee802_11/constellations.h>
 #include <ieee802_11/frame_equalizer.h>
 
@@ -49,9 +49,11 @@ public:
                      gr_vector_void_star& output_items);
 
 private:
-    bool parse_signal(uint8_t* signal);
+    bool parse_signal(const uint8_t* signal);
+    double symbol_time(int symbol);
     bool decode_signal_field(gr_complex* rx_bits);
     void print_coding(frame_coding coding);
+    void publish_ndp(double beta);
 
     equalizer::base* d_equalizer;
     gr::thread::mutex d_mutex;
@@ -60,9 +62,8 @@ private:
     bool d_log;
     int d_current_symbol;
     int d_sig;//the current sig field number
-    uint8_t d_sig_field_bits[200] = {0};//the bits contained in the sig field before decoding
-    uint8_t d_crc4_input_bytes[4];//the input bytes to the crc computer
-    viterbi_decoder d_decoder;
+    float d_sig_field_soft[NUM_CODED_BITS_IN_HALOW_SIG_FIELD];//combined soft bits of the sig field before decoding
+    sig_decoder d_sig_decoder;
 
     // freq offset
     double d_freq;                      // Hz
@@ -79,6 +80,14 @@ private:
     const int TRAVEL_PILOT2[TRAVELING_PILOT_POSITIONS] = {28,20, 25,17,22, 27,19, 24, 29,21, 26,18,23};
     bool d_travel_pilots = false;
 
+    uint64_t d_frame_start; // item offset of the wifi_start tag
+    bool d_short_gi;        // short GI after the first DATA symbol
+    bool d_ldpc;            // LDPC coded DATA field
+    bool d_aggregation;     // A-MPDU, the frame bytes fill all DATA symbols
+    bool d_ndp;             // NDP, no DATA field
+    uint32_t d_ndp_body;    // B0-B24 of the SIG field of an NDP
+    pmt::pmt_t d_rx_time;   // timestamp of the first LTF symbol, if any
+
     int d_frame_bytes;
     int d_frame_symbols;
     int d_frame_encoding;
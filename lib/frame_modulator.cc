@@ -0,0 +1,200 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "frame_modulator.h"
+#include "equalizer/base.h"
+
+using namespace gr::ieee802_11;
+
+// occupied carriers -13..-8, -6..-1, 1..6, 8..13 in shifted order
+const int frame_modulator::DATA_CARRIERS[CODED_BITS_PER_OFDM_SYMBOL] = {
+    3, 4, 5, 6, 7, 8, 10, 11, 12, 13, 14, 15, 17, 18, 19, 20, 21, 22, 24, 25, 26, 27, 28, 29
+};
+
+const gr_complex frame_modulator::STF[SAMPLES_PER_OFDM_SYMBOL] = {
+    0, 0, 0, 0, gr_complex(0.849837, 0.849837),  0, 0, 0,
+    gr_complex(-1.69967, -1.69967),  0, 0, 0, gr_complex(1.69967, 1.69967),  0, 0, 0,
+    0, 0, 0, 0, gr_complex(-1.69967, -1.69967),  0, 0, 0,
+    gr_complex(-1.69967, -1.69967),  0, 0, 0, gr_complex(-0.849837, -0.849837), 0, 0, 0
+};
+
+const gr_complex frame_modulator::LTF[SAMPLES_PER_OFDM_SYMBOL] = {
+    0, 0, 0, 1, -1, 1, -1, -1, 1, -1, 1, 1, -1, 1, 1, 1,
+    0, -1, -1, -1, 1, -1, -1, -1, 1, -1, 1, 1, 1, -1, 0, 0
+};
+
+frame_modulator::frame_modulator(Encoding e)
+    : d_ofdm(e),
+      d_ifft(SAMPLES_PER_OFDM_SYMBOL),
+      d_delay_line(0),
+      d_frame_short_gi(false),
+      d_frame_symbols(0),
+      d_frame_data_symbols(0),
+      d_symbol_index(0)
+{
+    set_encoding(e);
+}
+
+void frame_modulator::set_encoding(Encoding e)
+{
+    d_ofdm = ofdm_param(e);
+    d_points = d_ofdm.constellation->points();
+}
+
+int frame_modulator::frame_samples(int n_sym, bool short_gi)
+{
+    int n = (NUM_OFDM_SYMBOLS_IN_PREAMBLE + n_sym) * SAMPLES_PER_SYMBOL_WITH_GI + 1;
+    if (short_gi) {
+        n -= (n_sym - 1) * (SAMPLES_PER_GI - SAMPLES_PER_SHORT_GI);
+    }
+    return n;
+}
+
+void frame_modulator::map_symbol(const gr_complex* points, int n, gr_complex* carriers)
+{
+    std::fill(carriers, carriers + SAMPLES_PER_OFDM_SYMBOL, gr_complex(0, 0));
+
+    for (int i = 0; i < CODED_BITS_PER_OFDM_SYMBOL; i++) {
+        carriers[DATA_CARRIERS[i]] = points[i];
+    }
+
+    // {1, -1} on even and {-1, 1} on odd symbols, times the polarity sequence
+    gr_complex p = (n % 2 ? -1.0f : 1.0f) * equalizer::base::POLARITY[n % 127];
+    carriers[PILOT1_INDEX] = p;
+    carriers[PILOT2_INDEX] = -p;
+}
+
+void frame_modulator::ofdm_symbol(const gr_complex* carriers, gr_complex* out, int gi)
+{
+    // same scaling as the FFT window of the flow graph, 26 used subcarriers
+    static const float scale = 1 / std::sqrt(26.0f);
+
+    // undo the shift, bin 0 (DC) sits in the middle of carriers
+    gr_complex* in = d_ifft.get_inbuf();
+    for (int k = 0; k < SAMPLES_PER_OFDM_SYMBOL; k++) {
+        in[(k + SAMPLES_PER_OFDM_SYMBOL / 2) % SAMPLES_PER_OFDM_SYMBOL] = carriers[k] * scale;
+    }
+    d_ifft.execute();
+    const gr_complex* x = d_ifft.get_outbuf();
+
+    // guard interval
+    std::memcpy(out + gi, x, SAMPLES_PER_OFDM_SYMBOL * sizeof(gr_complex));
+    std::memcpy(out, x + SAMPLES_PER_OFDM_SYMBOL - gi, gi * sizeof(gr_complex));
+
+    // raised cosine window over two samples, like the cyclic prefixer with
+    // rolloff 2: the first sample overlaps with the extension of the last symbol
+    out[0] = out[0] * 0.5f + d_delay_line;
+    d_delay_line = x[0] * 0.5f;
+}
+
+void frame_modulator::start_frame(const char* psdu,
+                                  int psdu_length,
+                                  frame_param& frame,
+                                  uint8_t scrambler,
+                                  bool short_gi)
+{
+    // DATA field, one byte per subcarrier
+    encode_data_field(psdu, d_symbols, d_work[0], d_work[1], frame, d_ofdm, scrambler);
+
+    // SIG field, one bit per subcarrier
+    d_signal_field.generate_signal_field(d_sig_bits, frame, d_ofdm, short_gi);
+
+    d_frame_short_gi = short_gi;
+    d_frame_data_symbols = frame.n_sym;
+    d_frame_symbols = NUM_OFDM_SYMBOLS_IN_PREAMBLE + frame.n_sym;
+    d_symbol_index = 0;
+    d_delay_line = 0;
+}
+
+void frame_modulator::start_ndp(uint32_t body)
+{
+    d_signal_field.generate_ndp_signal_field(d_sig_bits, body);
+
+    d_frame_short_gi = false;
+    d_frame_data_symbols = 0;
+    d_frame_symbols = NUM_OFDM_SYMBOLS_IN_PREAMBLE;
+    d_symbol_index = 0;
+    d_delay_line = 0;
+}
+
+std::shared_ptr<std::vector<gr_complex>> frame_modulator::modulate()
+{
+    auto samples = std::make_shared<std::vector<gr_complex>>(
+        frame_samples(d_frame_data_symbols, d_frame_short_gi));
+    int o = 0;
+    while (!done()) {
+        o += next_symbol(samples->data() + o);
+    }
+    return samples;
+}
+
+int frame_modulator::next_symbol(gr_complex* out)
+{
+    gr_complex carriers[SAMPLES_PER_OFDM_SYMBOL];
+    gr_complex points[CODED_BITS_PER_OFDM_SYMBOL];
+    int len = SAMPLES_PER_SYMBOL_WITH_GI;
+    int n = d_symbol_index++;
+
+    if (n < NUM_OFDM_SYMBOLS_IN_STF) {
+        // STF, boosted by sqrt(2) for MCS10
+        float alpha = d_ofdm.encoding == BPSK_1_2_REP ? std::sqrt(2.0f) : 1;
+        for (int k = 0; k < SAMPLES_PER_OFDM_SYMBOL; k++) {
+            carriers[k] = STF[k] * alpha;
+        }
+        ofdm_symbol(carriers, out);
+
+    } else if (n == NUM_OFDM_SYMBOLS_IN_STF) {
+        // the first symbol of LTF1 is rotated by j^-k
+        static const gr_complex rotation[4] = {
+            gr_complex(1, 0), gr_complex(0, -1), gr_complex(-1, 0), gr_complex(0, 1)
+        };
+        for (int k = 0; k < SAMPLES_PER_OFDM_SYMBOL; k++) {
+            carriers[k] = LTF[k] * rotation[k % 4];
+        }
+        ofdm_symbol(carriers, out);
+
+    } else if (n < NUM_OFDM_SYMBOLS_IN_STF + NUM_OFDM_SYMBOLS_IN_LTF1) {
+        ofdm_symbol(LTF, out);
+
+    } else if (n < NUM_OFDM_SYMBOLS_IN_PREAMBLE) {
+        // SIG, BPSK
+        int s = n - NUM_OFDM_SYMBOLS_IN_STF - NUM_OFDM_SYMBOLS_IN_LTF1;
+        for (int i = 0; i < CODED_BITS_PER_OFDM_SYMBOL; i++) {
+            points[i] = d_sig_bits[s * CODED_BITS_PER_OFDM_SYMBOL + i] ? 1 : -1;
+        }
+        map_symbol(points, s, carriers);
+        ofdm_symbol(carriers, out);
+
+    } else {
+        // DATA
+        int s = n - NUM_OFDM_SYMBOLS_IN_PREAMBLE;
+        const char* symbols = d_symbols + s * CODED_BITS_PER_OFDM_SYMBOL;
+        for (int i = 0; i < CODED_BITS_PER_OFDM_SYMBOL; i++) {
+            points[i] = d_points[(unsigned char)symbols[i]];
+        }
+        map_symbol(points, NUM_OFDM_SYMBOLS_IN_SIG_FIELD + s, carriers);
+
+        // the first DATA symbol always has a normal GI
+        int gi = d_frame_short_gi && s > 0 ? SAMPLES_PER_SHORT_GI : SAMPLES_PER_GI;
+        ofdm_symbol(carriers, out, gi);
+        len = SAMPLES_PER_OFDM_SYMBOL + gi;
+    }
+
+    // tail of the window of the last symbol
+    if (n == d_frame_symbols - 1) {
+        out[len] = d_delay_line;
+        return len + 1;
+    }
+    return len;
+}
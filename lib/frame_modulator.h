@@ -0,0 +1,105 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef INCLUDED_IEEE802_11_FRAME_MODULATOR_H
+#define INCLUDED_IEEE802_11_FRAME_MODULATOR_H
+
+#include "signal_field_impl.h"
+#include "utils.h"
+#include <gnuradio/fft/fft.h>
+#include <memory>
+#include <vector>
+
+namespace gr {
+namespace ieee802_11 {
+
+#define NUM_OFDM_SYMBOLS_IN_STF 4
+#define SAMPLES_PER_SYMBOL_WITH_GI (SAMPLES_PER_OFDM_SYMBOL + SAMPLES_PER_GI)
+// STF, LTF1 and SIG, followed by the DATA field
+#define NUM_OFDM_SYMBOLS_IN_PREAMBLE \
+    (NUM_OFDM_SYMBOLS_IN_STF + NUM_OFDM_SYMBOLS_IN_LTF1 + NUM_OFDM_SYMBOLS_IN_SIG_FIELD)
+
+/* Baseband modulation of HaLow 1 MHz frames: STF, LTF1, SIG and DATA with
+ * pilots, IFFT, guard intervals and windowing.
+ *
+ * A frame is started with start_frame() or start_ndp() and then produced
+ * one OFDM symbol at a time with next_symbol(), or all at once with
+ * modulate(). Used by the OFDM modulator block and by the ACK responder of
+ * decode_mac, which precomputes its responses.
+ */
+class frame_modulator
+{
+public:
+    frame_modulator(Encoding e);
+
+    // encoding of the next frame
+    void set_encoding(Encoding e);
+    ofdm_param& ofdm() { return d_ofdm; }
+
+    // encodes DATA and SIG, the samples are produced symbol by symbol later
+    void start_frame(const char* psdu,
+                     int psdu_length,
+                     frame_param& frame,
+                     uint8_t scrambler,
+                     bool short_gi);
+    // same for an NDP, STF, LTF1 and a SIG field with the NDP body
+    void start_ndp(uint32_t body);
+
+    bool done() const { return d_symbol_index == d_frame_symbols; }
+    // writes the next OFDM symbol of the frame (plus the window tail after
+    // the last one) and returns the number of samples
+    int next_symbol(gr_complex* out);
+    // all remaining symbols of the frame, frame_samples() of them
+    std::shared_ptr<std::vector<gr_complex>> modulate();
+
+    // length of a frame with n_sym DATA symbols, including the window tail
+    static int frame_samples(int n_sym, bool short_gi);
+
+private:
+    // maps one OFDM symbol worth of points to the data subcarriers and adds
+    // the pilots of the n-th symbol after LTF1
+    void map_symbol(const gr_complex* points, int n, gr_complex* carriers);
+    // IFFT, guard interval and windowing of one symbol (carriers in shifted order)
+    void ofdm_symbol(const gr_complex* carriers, gr_complex* out, int gi = SAMPLES_PER_GI);
+
+    // encoding of the current frame
+    ofdm_param d_ofdm;
+    // constellation points of the current encoding, indexed by symbol value
+    std::vector<gr_complex> d_points;
+
+    signal_field_impl d_signal_field;
+    gr::fft::fft_complex_rev d_ifft;
+
+    // window overlap carried into the guard interval of the next symbol
+    gr_complex d_delay_line;
+
+    char d_work[2][MAX_CODING_BITS];
+    char d_symbols[MAX_FRAME_SYMBOLS];
+    char d_sig_bits[CODED_BITS_PER_OFDM_SYMBOL * NUM_OFDM_SYMBOLS_IN_SIG_FIELD];
+
+    // position in the current frame, in OFDM symbols
+    bool d_frame_short_gi;
+    int d_frame_symbols;
+    int d_frame_data_symbols;
+    int d_symbol_index;
+
+    static const int DATA_CARRIERS[CODED_BITS_PER_OFDM_SYMBOL];
+    static const gr_complex STF[SAMPLES_PER_OFDM_SYMBOL];
+    static const gr_complex LTF[SAMPLES_PER_OFDM_SYMBOL];
+};
+
+} // namespace ieee802_11
+} // namespace gr
+
+#endif /* INCLUDED_IEEE802_11_FRAME_MODULATOR_H */
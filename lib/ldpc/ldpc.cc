@@ -0,0 +1,331 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "ldpc.h"
+#include "../utils.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace gr {
+namespace ieee802_11 {
+
+/* Base matrices of the 802.11 LDPC codes, Tables F-1 to F-3. The rows are
+ * (block row) x 24 block columns, the last (rows) columns are the dual
+ * diagonal parity part.
+ */
+static const int8_t H_648_1_2[] = {
+     0, -1, -1, -1,  0,  0, -1, -1,  0, -1, -1,  0,  1,  0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    22,  0, -1, -1, 17, -1,  0,  0, 12, -1, -1, -1, -1,  0,  0, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+     6, -1,  0, -1, 10, -1, -1, -1, 24, -1,  0, -1, -1, -1,  0,  0, -1, -1, -1, -1, -1, -1, -1, -1,
+     2, -1, -1,  0, 20, -1, -1, -1, 25,  0, -1, -1, -1, -1, -1,  0,  0, -1, -1, -1, -1, -1, -1, -1,
+    23, -1, -1, -1,  3, -1, -1, -1,  0, -1,  9, 11, -1, -1, -1, -1,  0,  0, -1, -1, -1, -1, -1, -1,
+    24, -1, 23,  1, 17, -1,  3, -1, 10, -1, -1, -1, -1, -1, -1, -1, -1,  0,  0, -1, -1, -1, -1, -1,
+    25, -1, -1, -1,  8, -1, -1, -1,  7, 18, -1, -1,  0, -1, -1, -1, -1, -1,  0,  0, -1, -1, -1, -1,
+    13, 24, -1, -1,  0, -1,  8, -1,  6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0,  0, -1, -1, -1,
+     7, 20, -1, 16, 22, 10, -1, -1, 23, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0,  0, -1, -1,
+    11, -1, -1, -1, 19, -1, -1, -1, 13, -1,  3, 17, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0,  0, -1,
+    25, -1,  8, -1, 23, 18, -1, 14,  9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0,  0,
+     3, -1, -1, -1, 16, -1, -1,  2, 25,  5, -1, -1,  1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0,
+};
+
+static const int8_t H_648_2_3[] = {
+    25, 26, 14, -1, 20, -1,  2, -1,  4, -1, -1,  8, -1, 16, -1, 18,  1,  0, -1, -1, -1, -1, -1, -1,
+    10,  9, 15, 11, -1,  0, -1,  1, -1, -1, 18, -1,  8, -1, 10, -1, -1,  0,  0, -1, -1, -1, -1, -1,
+    16,  2, 20, 26, 21, -1,  6, -1,  1, 26, -1,  7, -1, -1, -1, -1, -1, -1,  0,  0, -1, -1, -1, -1,
+    10, 13,  5,  0, -1,  3, -1,  7, -1, -1, 26, -1, -1, 13, -1, 16, -1, -1, -1,  0,  0, -1, -1, -1,
+    23, 14, 24, -1, 12, -1, 19, -1, 17, -1, -1, -1, 20, -1, 21, -1,  0, -1, -1, -1,  0,  0, -1, -1,
+     6, 22,  9, 20, -1, 25, -1, 17, -1,  8, -1, 14, -1, 18, -1, -1, -1, -1, -1, -1, -1,  0,  0, -1,
+    14, 23, 21, 11, 20, -1, 24, -1, 18, -1, 19, -1, -1, -1, -1, 22, -1, -1, -1, -1, -1, -1,  0,  0,
+    17, 11, 11, 20, -1, 21, -1, 26, -1,  3, -1, -1, 18, -1, 26, -1,  1, -1, -1, -1, -1, -1, -1,  0,
+};
+
+static const int8_t H_648_3_4[] = {
+    16, 17, 22, 24,  9,  3, 14, -1,  4,  2,  7, -1, 26, -1,  2, -1, 21, -1,  1,  0, -1, -1, -1, -1,
+    25, 12, 12,  3,  3, 26,  6, 21, -1, 15, 22, -1, 15, -1,  4, -1, -1, 16, -1,  0,  0, -1, -1, -1,
+    25, 18, 26, 16, 22, 23,  9, -1,  0, -1,  4, -1,  4, -1,  8, 23, 11, -1, -1, -1,  0,  0, -1, -1,
+     9,  7,  0,  1, 17, -1, -1,  7,  3, -1,  3, 23, -1, 16, -1, -1, 21, -1,  0, -1, -1,  0,  0, -1,
+    24,  5, 26,  7,  1, -1, -1, 15, 24, 15, -1,  8, -1, 13, -1, 13, -1, 11, -1, -1, -1, -1,  0,  0,
+     2,  2, 19, 14, 24,  1, 15, 19, -1, 21, -1,  2, -1, 24, -1,  3, -1,  2,  1, -1, -1, -1, -1,  0,
+};
+
+static const int8_t H_648_5_6[] = {
+    17, 13,  8, 21,  9,  3, 18, 12, 10,  0,  4, 15, 19,  2,  5, 10, 26, 19, 13, 13,  1,  0, -1, -1,
+     3, 12, 11, 14, 11, 25,  5, 18,  0,  9,  2, 26, 26, 10, 24,  7, 14, 20,  4,  2, -1,  0,  0, -1,
+    22, 16,  4,  3, 10, 21, 12,  5, 21, 14, 19,  5, -1,  8,  5, 18, 11,  5,  5, 15,  0, -1,  0,  0,
+     7,  7, 14, 14,  4, 16, 16, 24, 24, 10,  1,  7, 15,  6, 10, 26,  8, 18, 21, 14,  1, -1, -1,  0,
+};
+
+static const int8_t H_1296_1_2[] = {
+    40, -1, -1, -1, 22, -1, 49, 23, 43, -1, -1, -1,  1,  0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    50,  1, -1, -1, 48, 35, -1, -1, 13, -1, 30, -1, -1,  0,  0, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    39, 50, -1, -1,  4, -1,  2, -1, -1, -1, -1, 49, -1, -1,  0,  0, -1, -1, -1, -1, -1, -1, -1, -1,
+    33, -1, -1, 38, 37, -1, -1,  4,  1, -1, -1, -1, -1, -1, -1,  0,  0, -1, -1, -1, -1, -1, -1, -1,
+    45, -1, -1, -1,  0, 22, -1, -1, 20, 42, -1, -1, -1, -1, -1, -1,  0,  0, -1, -1, -1, -1, -1, -1,
+    51, -1, -1, 48, 35, -1, -1, -1, 44, -1, 18, -1, -1, -1, -1, -1, -1,  0,  0, -1, -1, -1, -1, -1,
+    47, 11, -1, -1, -1, 17, -1, -1, 51, -1, -1, -1,  0, -1, -1, -1, -1, -1,  0,  0, -1, -1, -1, -1,
+     5, -1, 25, -1,  6, -1, 45, -1, 13, 40, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0,  0, -1, -1, -1,
+    33, -1, -1, 34, 24, -1, -1, -1, 23, -1, -1, 46, -1, -1, -1, -1, -1, -1, -1, -1,  0,  0, -1, -1,
+     1, -1, 27, -1,  1, -1, -1, -1, 38, -1, 44, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0,  0, -1,
+    -1, 18, -1, -1, 23, -1, -1,  8,  0, 35, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0,  0,
+    49, -1, 17, -1, 30, -1, -1, -1, 34, -1, -1, 19,  1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0,
+};
+
+static const int8_t H_1296_2_3[] = {
+    39, 31, 22, 43, -1, 40,  4, -1, 11, -1, -1, 50, -1, -1, -1,  6,  1,  0, -1, -1, -1, -1, -1, -1,
+    25, 52, 41,  2,  6, -1, 14, -1, 34, -1, -1, -1, 24, -1, 37, -1, -1,  0,  0, -1, -1, -1, -1, -1,
+    43, 31, 29,  0, 21, -1, 28, -1, -1,  2, -1, -1,  7, -1, 17, -1, -1, -1,  0,  0, -1, -1, -1, -1,
+    20, 33, 48, -1,  4, 13, -1, 26, -1, -1, 22, -1, -1, 46, 42, -1, -1, -1, -1,  0,  0, -1, -1, -1,
+    45,  7, 18, 51, 12, 25, -1, -1, -1, 50, -1, -1,  5, -1, -1, -1,  0, -1, -1, -1,  0,  0, -1, -1,
+    35, 40, 32, 16,  5, -1, -1, 18, -1, -1, 43, 51, -1, 32, -1, -1, -1, -1, -1, -1, -1,  0,  0, -1,
+     9, 24, 13, 22, 28, -1, -1, 37, -1, -1, 25, -1, -1, 52, -1, 13, -1, -1, -1, -1, -1, -1,  0,  0,
+    32, 22,  4, 21, 16, -1, -1, -1, 27, 28, -1, 38, -1, -1, -1,  8,  1, -1, -1, -1, -1, -1, -1,  0,
+};
+
+static const int8_t H_1296_3_4[] = {
+    39, 40, 51, 41,  3, 29,  8, 36, -1, 14, -1,  6, -1, 33, -1, 11, -1,  4,  1,  0, -1, -1, -1, -1,
+    48, 21, 47,  9, 48, 35, 51, -1, 38, -1, 28, -1, 34, -1, 50, -1, 50, -1, -1,  0,  0, -1, -1, -1,
+    30, 39, 28, 42, 50, 39,  5, 17, -1,  6, -1, 18, -1, 20, -1, 15, -1, 40, -1, -1,  0,  0, -1, -1,
+    29,  0,  1, 43, 36, 30, 47, -1, 49, -1, 47, -1,  3, -1, 35, -1, 34, -1,  0, -1, -1,  0,  0, -1,
+     1, 32, 11, 23, 10, 44, 12,  7, -1, 48, -1,  4, -1,  9, -1, 17, -1, 16, -1, -1, -1, -1,  0,  0,
+    13,  7, 15, 47, 23, 16, 47, -1, 43, -1, 29, -1, 52, -1,  2, -1, 53, -1,  1, -1, -1, -1, -1,  0,
+};
+
+static const int8_t H_1296_5_6[] = {
+    48, 29, 37, 52,  2, 16,  6, 14, 53, 31, 34,  5, 18, 42, 53, 31, 45, -1, 46, 52,  1,  0, -1, -1,
+    17,  4, 30,  7, 43, 11, 24,  6, 14, 21,  6, 39, 17, 40, 47,  7, 15, 41, 19, -1, -1,  0,  0, -1,
+     7,  2, 51, 31, 46, 23, 16, 11, 53, 40, 10,  7, 46, 53, 33, 35, -1, 25, 35, 38,  0, -1,  0,  0,
+    19, 48, 41,  1, 10,  7, 36, 47,  5, 29, 52, 52, 31, 10, 26,  6,  3,  2, -1, 51,  1, -1, -1,  0,
+};
+
+static const int8_t H_1944_1_2[] = {
+    57, -1, -1, -1, 50, -1, 11, -1, 50, -1, 79, -1,  1,  0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+     3, -1, 28, -1,  0, -1, -1, -1, 55,  7, -1, -1, -1,  0,  0, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    30, -1, -1, -1, 24, 37, -1, -1, 56, 14, -1, -1, -1, -1,  0,  0, -1, -1, -1, -1, -1, -1, -1, -1,
+    62, 53, -1, -1, 53, -1, -1,  3, 35, -1, -1, -1, -1, -1, -1,  0,  0, -1, -1, -1, -1, -1, -1, -1,
+    40, -1, -1, 20, 66, -1, -1, 22, 28, -1, -1, -1, -1, -1, -1, -1,  0,  0, -1, -1, -1, -1, -1, -1,
+     0, -1, -1, -1,  8, -1, 42, -1, 50, -1, -1,  8, -1, -1, -1, -1, -1,  0,  0, -1, -1, -1, -1, -1,
+    69, 79, 79, -1, -1, -1, 56, -1, 52, -1, -1, -1,  0, -1, -1, -1, -1, -1,  0,  0, -1, -1, -1, -1,
+    65, -1, -1, -1, 38, 57, -1, -1, 72, -1, 27, -1, -1, -1, -1, -1, -1, -1, -1,  0,  0, -1, -1, -1,
+    64, -1, -1, -1, 14, 52, -1, -1, 30, -1, -1, 32, -1, -1, -1, -1, -1, -1, -1, -1,  0,  0, -1, -1,
+    -1, 45, -1, 70,  0, -1, -1, -1, 77,  9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0,  0, -1,
+     2, 56, -1, 57, 35, -1, -1, -1, -1, -1, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0,  0,
+    24, -1, 61, -1, 60, -1, -1, 27, 51, -1, -1, 16,  1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0,
+};
+
+static const int8_t H_1944_2_3[] = {
+    61, 75,  4, 63, 56, -1, -1, -1, -1, -1, -1,  8, -1,  2, 17, 25,  1,  0, -1, -1, -1, -1, -1, -1,
+    56, 74, 77, 20, -1, -1, -1, 64, 24,  4, 67, -1,  7, -1, -1, -1, -1,  0,  0, -1, -1, -1, -1, -1,
+    28, 21, 68, 10,  7, 14, 65, -1, -1, -1, 23, -1, -1, -1, 75, -1, -1, -1,  0,  0, -1, -1, -1, -1,
+    48, 38, 43, 78, 76, -1, -1, -1, -1,  5, 36, -1, 15, 72, -1, -1, -1, -1, -1,  0,  0, -1, -1, -1,
+    40,  2, 53, 25, -1, 52, 62, -1, 20, -1, -1, 44, -1, -1, -1, -1,  0, -1, -1, -1,  0,  0, -1, -1,
+    69, 23, 64, 10, 22, -1, 21, -1, -1, -1, -1, -1, 68, 23, 29, -1, -1, -1, -1, -1, -1,  0,  0, -1,
+    12,  0, 68, 20, 55, 61, -1, 40, -1, -1, -1, 52, -1, -1, -1, 44, -1, -1, -1, -1, -1, -1,  0,  0,
+    58,  8, 34, 64, 78, -1, -1, 11, 78, 24, -1, -1, -1, -1, -1, 58,  1, -1, -1, -1, -1, -1, -1,  0,
+};
+
+static const int8_t H_1944_3_4[] = {
+    48, 29, 28, 39,  9, 61, -1, -1, -1, 63, 45, 80, -1, -1, -1, 37, 32, 22,  1,  0, -1, -1, -1, -1,
+     4, 49, 42, 48, 11, 30, -1, -1, -1, 49, 17, 41, 37, 15, -1, 54, -1, -1, -1,  0,  0, -1, -1, -1,
+    35, 76, 78, 51, 37, 35, 21, -1, 17, 64, -1, -1, -1, 59,  7, -1, -1, 32, -1, -1,  0,  0, -1, -1,
+     9, 65, 44,  9, 54, 56, 73, 34, 42, -1, -1, -1, 35, -1, -1, -1, 46, 39,  0, -1, -1,  0,  0, -1,
+     3, 62,  7, 80, 68, 26, -1, 80, 55, -1, 36, -1, 26, -1,  9, -1, 72, -1, -1, -1, -1, -1,  0,  0,
+    26, 75, 33, 21, 69, 59,  3, 38, -1, -1, -1, 35, -1, 62, 36, 26, -1, -1,  1, -1, -1, -1, -1,  0,
+};
+
+static const int8_t H_1944_5_6[] = {
+    13, 48, 80, 66,  4, 74,  7, 30, 76, 52, 37, 60, -1, 49, 73, 31, 74, 73, 23, -1,  1,  0, -1, -1,
+    69, 63, 74, 56, 64, 77, 57, 65,  6, 16, 51, -1, 64, -1, 68,  9, 48, 62, 54, 27, -1,  0,  0, -1,
+    51, 15,  0, 80, 24, 25, 42, 54, 44, 71, 71,  9, 67, 35, -1, 58, -1, 29, -1, 53,  0, -1,  0,  0,
+    16, 29, 36, 41, 44, 56, 59, 37, 50, 24, -1, 65,  4, 65, 52, -1,  4, -1, 73, 52,  1, -1, -1,  0,
+};
+static const ldpc_code CODES[] = {
+    { 648, 27, 12, H_648_1_2 },   { 648, 27, 8, H_648_2_3 },
+    { 648, 27, 6, H_648_3_4 },    { 648, 27, 4, H_648_5_6 },
+    { 1296, 54, 12, H_1296_1_2 }, { 1296, 54, 8, H_1296_2_3 },
+    { 1296, 54, 6, H_1296_3_4 },  { 1296, 54, 4, H_1296_5_6 },
+    { 1944, 81, 12, H_1944_1_2 }, { 1944, 81, 8, H_1944_2_3 },
+    { 1944, 81, 6, H_1944_3_4 },  { 1944, 81, 4, H_1944_5_6 },
+};
+
+const ldpc_code* ldpc_get_code(int n, int rate_num, int rate_den)
+{
+    for (const ldpc_code& c : CODES) {
+        // k / n == num / den, the rate does not have to be reduced
+        if (c.n == n && c.k() * rate_den == n * rate_num) {
+            return &c;
+        }
+    }
+    return nullptr;
+}
+
+
+ldpc_param::ldpc_param()
+    : code(nullptr),
+      n_pld(0),
+      n_cw(0),
+      n_avbits(0),
+      n_shrt(0),
+      n_punc(0),
+      n_rep(0),
+      n_sym(0),
+      extra(false)
+{
+}
+
+/* PPDU encoding process of 19.3.11.7.5 for one spatial stream without STBC.
+ * The code rate is R = n_dbps / n_cbps, all comparisons against fractions of
+ * R are done on integers scaled by n_cbps.
+ */
+ldpc_param::ldpc_param(int n_pld, int n_cbps, int n_dbps) : ldpc_param()
+{
+    this->n_pld = n_pld;
+
+    const int c = n_cbps;
+    const int d = n_dbps;
+
+    n_avbits = n_cbps * ((n_pld + n_dbps - 1) / n_dbps);
+
+    // Table 19-16, codeword length and count
+    int l;
+    if (n_avbits <= 648) {
+        n_cw = 1;
+        l = (n_avbits - n_pld) * c >= 912 * (c - d) ? 1296 : 648;
+    } else if (n_avbits <= 1296) {
+        n_cw = 1;
+        l = (n_avbits - n_pld) * c >= 1464 * (c - d) ? 1944 : 1296;
+    } else if (n_avbits <= 1944) {
+        n_cw = 1;
+        l = 1944;
+    } else if (n_avbits <= 2592) {
+        n_cw = 2;
+        l = (n_avbits - n_pld) * c >= 2916 * (c - d) ? 1944 : 1296;
+    } else {
+        n_cw = (n_pld * c + 1944 * d - 1) / (1944 * d);
+        l = 1944;
+    }
+
+    code = ldpc_get_code(l, d, c);
+    if (!code) {
+        throw std::invalid_argument("no LDPC code for this rate");
+    }
+
+    const int k = code->k();
+    const int parity = l - k;
+
+    n_shrt = std::max(0, n_cw * k - n_pld);
+    n_punc = std::max(0, n_cw * l - n_avbits - n_shrt);
+
+    // too much puncturing, add one more symbol
+    if ((10 * n_punc > n_cw * parity && 10 * n_shrt * parity < 12 * n_punc * k) ||
+        10 * n_punc > 3 * n_cw * parity) {
+        n_avbits += n_cbps;
+        n_punc = std::max(0, n_cw * l - n_avbits - n_shrt);
+        extra = true;
+    }
+
+    n_rep = std::max(0, n_avbits - n_cw * parity - n_pld);
+    n_sym = n_avbits / n_cbps;
+}
+
+
+void ldpc_encode(const ldpc_code& code, uint8_t* cw)
+{
+    const int z = code.z;
+    const int rows = code.rows;
+    const int kb = LDPC_BLOCK_COLS - rows;
+
+    uint8_t lambda[LDPC_BLOCK_COLS][LDPC_MAX_Z];
+    std::memset(lambda, 0, sizeof(lambda));
+
+    // syndrome of the information part, one Z bit vector per block row
+    for (int r = 0; r < rows; r++) {
+        for (int b = 0; b < kb; b++) {
+            int s = code.shifts[r * LDPC_BLOCK_COLS + b];
+            if (s < 0) {
+                continue;
+            }
+            const uint8_t* info = cw + b * z;
+            for (int i = 0; i < z; i++) {
+                lambda[r][i] ^= info[(i + s) % z];
+            }
+        }
+    }
+
+    // the first parity column (shifts 1, 0, 1) sums up to the identity, the
+    // dual diagonal cancels out when all block rows are added up
+    uint8_t* p0 = cw + kb * z;
+    std::memset(p0, 0, z);
+    for (int r = 0; r < rows; r++) {
+        for (int i = 0; i < z; i++) {
+            p0[i] ^= lambda[r][i];
+        }
+    }
+
+    // then walk down the dual diagonal
+    for (int r = 0; r < rows - 1; r++) {
+        int s = code.shifts[r * LDPC_BLOCK_COLS + kb];
+        uint8_t* p = cw + (kb + r + 1) * z;
+        const uint8_t* prev = r ? cw + (kb + r) * z : nullptr;
+        for (int i = 0; i < z; i++) {
+            p[i] = lambda[r][i] ^ (s >= 0 ? p0[(i + s) % z] : 0) ^ (prev ? prev[i] : 0);
+        }
+    }
+}
+
+
+void ldpc_encode_frame(const char* in, char* out, const ldpc_param& param)
+{
+    const ldpc_code& code = *param.code;
+    const int k = code.k();
+    uint8_t cw[LDPC_MAX_N];
+
+    for (int i = 0; i < param.n_cw; i++) {
+        int info = k - param.shrt(i);
+        int parity = code.n - k - param.punc(i);
+
+        // shortening bits are zero and not transmitted
+        for (int j = 0; j < info; j++) {
+            cw[j] = in[j];
+        }
+        std::memset(cw + info, 0, k - info);
+        in += info;
+
+        ldpc_encode(code, cw);
+
+        char* start = out;
+        std::memcpy(out, cw, info);
+        out += info;
+        // puncturing removes the last parity bits
+        std::memcpy(out, cw + k, parity);
+        out += parity;
+
+        // repetition copies the codeword from its start
+        int sent = info + parity;
+        for (int j = 0; j < param.rep(i); j++) {
+            *out++ = start[j % sent];
+        }
+    }
+}
+
+
+int ldpc_tone(int k)
+{
+    const int n = CODED_BITS_PER_OFDM_SYMBOL / LDPC_TONE_MAPPING_DISTANCE;
+    return LDPC_TONE_MAPPING_DISTANCE * (k % n) + k / n;
+}
+
+} // namespace ieee802_11
+} // namespace gr
@@ -0,0 +1,93 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef INCLUDED_IEEE802_11_LDPC_H
+#define INCLUDED_IEEE802_11_LDPC_H
+
+#include <cstdint>
+
+namespace gr {
+namespace ieee802_11 {
+
+// all 802.11 LDPC codes have 24 block columns
+#define LDPC_BLOCK_COLS 24
+#define LDPC_MAX_N 1944
+#define LDPC_MAX_Z 81
+// LDPC tone mapping distance of the 24 data subcarriers of a 1 MHz symbol
+#define LDPC_TONE_MAPPING_DISTANCE 8
+
+/*
+ * Quasi-cyclic parity check matrix of one of the 12 802.11 LDPC codes
+ * (Annex F). Every entry of the rows x 24 base matrix is the right cyclic
+ * shift of a Z x Z identity, -1 stands for the zero block.
+ */
+struct ldpc_code {
+    int n;    // codeword length
+    int z;    // lifting size
+    int rows; // block rows, the code has (24 - rows) * z information bits
+    const int8_t* shifts;
+
+    int k() const { return (LDPC_BLOCK_COLS - rows) * z; }
+};
+
+/*
+ * LDPC PPDU encoding parameters (codeword length and count, shortening,
+ * puncturing and repetition) of a DATA field with n_pld payload bits,
+ * 19.3.11.7.5. These also fix the number of OFDM symbols and the LDPC
+ * extra symbol bit of the SIG field.
+ */
+class ldpc_param
+{
+public:
+    ldpc_param();
+    ldpc_param(int n_pld, int n_cbps, int n_dbps);
+
+    const ldpc_code* code;
+    int n_pld;
+    int n_cw;
+    int n_avbits;
+    int n_shrt;
+    int n_punc;
+    int n_rep;
+    int n_sym;
+    bool extra;
+
+    // shortened, punctured and repeated bits of codeword i
+    int shrt(int i) const { return n_shrt / n_cw + (i < n_shrt % n_cw); }
+    int punc(int i) const { return n_punc / n_cw + (i < n_punc % n_cw); }
+    int rep(int i) const { return n_rep / n_cw + (i < n_rep % n_cw); }
+};
+
+// returns nullptr if there is no code with this length and rate
+const ldpc_code* ldpc_get_code(int n, int rate_num, int rate_den);
+
+/*
+ * Systematic encoding: cw holds the k information bits (one per byte), the
+ * n - k parity bits are appended.
+ */
+void ldpc_encode(const ldpc_code& code, uint8_t* cw);
+
+/*
+ * Encodes the n_pld scrambled payload bits of a DATA field and writes the
+ * n_avbits coded bits, already shortened, punctured and repeated.
+ */
+void ldpc_encode_frame(const char* in, char* out, const ldpc_param& param);
+
+// data subcarrier the k-th point of a symbol is mapped to (LDPC tone mapper)
+int ldpc_tone(int k);
+
+} // namespace ieee802_11
+} // namespace gr
+
+#endif /* INCLUDED_IEEE802_11_LDPC_H */
@@ -0,0 +1,236 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "ldpc_decoder.h"
+#include "../utils.h"
+
+#include <cmath>
+#include <cstring>
+
+#ifdef IEEE80211_MSSE2
+#include <emmintrin.h>
+#endif
+
+using namespace gr::ieee802_11;
+
+// scaling of the check node messages, corrects the min-sum overestimate
+#define LDPC_NORMALIZATION 0.75f
+// LLR of the shortening bits, which are known to be zero
+#define LDPC_KNOWN_BIT 1e6f
+
+ldpc_decoder::ldpc_decoder() : d_iterations(0)
+{
+    std::memset(d_l, 0, sizeof(d_l));
+    std::memset(d_r, 0, sizeof(d_r));
+    std::memset(d_t, 0, sizeof(d_t));
+}
+
+
+bool ldpc_decoder::decode(const float* llr, uint8_t* out, const ldpc_param& param)
+{
+    const ldpc_code& code = *param.code;
+    const int k = code.k();
+    const int z = code.z;
+
+    float cw[LDPC_MAX_N];
+    bool ok = true;
+    int pos = 0;
+
+    std::memset(out, 0, (param.n_pld + 7) / 8);
+    d_iterations = 0;
+
+    for (int i = 0; i < param.n_cw; i++) {
+        int info = k - param.shrt(i);
+        int parity = code.n - k - param.punc(i);
+        int sent = info + parity;
+
+        // undo shortening, puncturing and repetition
+        std::memcpy(cw, llr, info * sizeof(float));
+        std::fill(cw + info, cw + k, LDPC_KNOWN_BIT);
+        std::memcpy(cw + k, llr + info, parity * sizeof(float));
+        std::fill(cw + k + parity, cw + code.n, 0.0f);
+        for (int j = 0; j < param.rep(i); j++) {
+            int b = j % sent;
+            cw[b < info ? b : k + b - info] += llr[sent + j];
+        }
+        llr += sent + param.rep(i);
+
+        for (int b = 0; b < LDPC_BLOCK_COLS; b++) {
+            std::memcpy(d_l[b], cw + b * z, z * sizeof(float));
+        }
+
+        ok &= decode_codeword(code);
+
+        for (int j = 0; j < info; j++, pos++) {
+            if (d_l[j / z][j % z] < 0) {
+                SET_PACKED_BIT(out, pos);
+            }
+        }
+    }
+
+    return ok;
+}
+
+
+bool ldpc_decoder::decode_codeword(const ldpc_code& code)
+{
+    int blocks = 0;
+    for (int i = 0; i < code.rows * LDPC_BLOCK_COLS; i++) {
+        blocks += code.shifts[i] >= 0;
+    }
+    std::memset(d_r, 0, blocks * sizeof(d_r[0]));
+
+    if (check(code)) {
+        return true;
+    }
+
+    for (int it = 0; it < LDPC_MAX_ITERATIONS; it++) {
+        d_iterations++;
+
+        float* r = d_r[0];
+        for (int row = 0; row < code.rows; row++) {
+            update_layer(code, row, r);
+            for (int b = 0; b < LDPC_BLOCK_COLS; b++) {
+                r += (code.shifts[row * LDPC_BLOCK_COLS + b] >= 0) * LDPC_LANES;
+            }
+        }
+
+        if (check(code)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+void ldpc_decoder::update_layer(const ldpc_code& code, int row, float* r)
+{
+    const int z = code.z;
+    const int8_t* shifts = code.shifts + row * LDPC_BLOCK_COLS;
+
+    int cols[LDPC_MAX_ROW_DEGREE];
+    int deg = 0;
+
+    // gather: lane i of block b is variable node (i + s) % z
+    for (int b = 0; b < LDPC_BLOCK_COLS; b++) {
+        int s = shifts[b];
+        if (s < 0) {
+            continue;
+        }
+        float* t = d_t[deg];
+        const float* rb = r + deg * LDPC_LANES;
+        std::memcpy(t, d_l[b] + s, (z - s) * sizeof(float));
+        std::memcpy(t + z - s, d_l[b], s * sizeof(float));
+        for (int i = 0; i < z; i++) {
+            t[i] -= rb[i];
+        }
+        // keep the padding lanes finite
+        std::fill(t + z, t + LDPC_LANES, 0.0f);
+        cols[deg++] = b;
+    }
+
+#ifdef IEEE80211_MSSE2
+    const __m128 sign_mask = _mm_set1_ps(-0.0f);
+    const __m128 norm = _mm_set1_ps(LDPC_NORMALIZATION);
+
+    for (int i = 0; i < z; i += 4) {
+        __m128 min1 = _mm_set1_ps(INFINITY);
+        __m128 min2 = _mm_set1_ps(INFINITY);
+        __m128 idx = _mm_set1_ps(-1);
+        __m128 sign = _mm_setzero_ps();
+
+        for (int j = 0; j < deg; j++) {
+            __m128 t = _mm_load_ps(d_t[j] + i);
+            __m128 a = _mm_andnot_ps(sign_mask, t);
+            sign = _mm_xor_ps(sign, _mm_and_ps(sign_mask, t));
+
+            __m128 lt = _mm_cmplt_ps(a, min1);
+            min2 = _mm_or_ps(_mm_and_ps(lt, min1), _mm_andnot_ps(lt, _mm_min_ps(min2, a)));
+            min1 = _mm_min_ps(min1, a);
+            idx = _mm_or_ps(_mm_and_ps(lt, _mm_set1_ps(j)), _mm_andnot_ps(lt, idx));
+        }
+
+        min1 = _mm_mul_ps(min1, norm);
+        min2 = _mm_mul_ps(min2, norm);
+
+        for (int j = 0; j < deg; j++) {
+            __m128 t = _mm_load_ps(d_t[j] + i);
+            __m128 own = _mm_cmpeq_ps(idx, _mm_set1_ps(j));
+            __m128 mag = _mm_or_ps(_mm_and_ps(own, min2), _mm_andnot_ps(own, min1));
+            // sign of all other messages
+            __m128 s = _mm_xor_ps(sign, _mm_and_ps(sign_mask, t));
+            __m128 msg = _mm_or_ps(mag, s);
+            _mm_store_ps(r + j * LDPC_LANES + i, msg);
+            _mm_store_ps(d_t[j] + i, _mm_add_ps(t, msg));
+        }
+    }
+#else
+    for (int i = 0; i < z; i++) {
+        float min1 = INFINITY;
+        float min2 = INFINITY;
+        int idx = -1;
+        bool sign = false;
+
+        for (int j = 0; j < deg; j++) {
+            float a = std::fabs(d_t[j][i]);
+            sign ^= std::signbit(d_t[j][i]);
+            if (a < min1) {
+                min2 = min1;
+                min1 = a;
+                idx = j;
+            } else if (a < min2) {
+                min2 = a;
+            }
+        }
+
+        for (int j = 0; j < deg; j++) {
+            float mag = LDPC_NORMALIZATION * (j == idx ? min2 : min1);
+            float msg = (sign ^ std::signbit(d_t[j][i])) ? -mag : mag;
+            r[j * LDPC_LANES + i] = msg;
+            d_t[j][i] += msg;
+        }
+    }
+#endif
+
+    // scatter the updated LLRs back
+    for (int j = 0; j < deg; j++) {
+        int s = shifts[cols[j]];
+        std::memcpy(d_l[cols[j]] + s, d_t[j], (z - s) * sizeof(float));
+        std::memcpy(d_l[cols[j]], d_t[j] + z - s, s * sizeof(float));
+    }
+}
+
+
+bool ldpc_decoder::check(const ldpc_code& code)
+{
+    const int z = code.z;
+
+    for (int row = 0; row < code.rows; row++) {
+        for (int i = 0; i < z; i++) {
+            bool parity = false;
+            for (int b = 0; b < LDPC_BLOCK_COLS; b++) {
+                int s = code.shifts[row * LDPC_BLOCK_COLS + b];
+                if (s >= 0) {
+                    parity ^= d_l[b][(i + s) % z] < 0;
+                }
+            }
+            if (parity) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,70 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef INCLUDED_IEEE802_11_LDPC_DECODER_H
+#define INCLUDED_IEEE802_11_LDPC_DECODER_H
+
+#include "ldpc.h"
+
+namespace gr {
+namespace ieee802_11 {
+
+// lifting size rounded up to whole SSE registers
+#define LDPC_LANES 84
+// most non-zero blocks of all base matrices
+#define LDPC_MAX_BLOCKS 88
+// most non-zero blocks in one block row
+#define LDPC_MAX_ROW_DEGREE 22
+#define LDPC_MAX_ITERATIONS 20
+
+/* Layered normalized min-sum decoder for the 802.11 LDPC codes.
+ *
+ * The Z check nodes of a block row never share a variable node, so a whole
+ * layer is updated at once: the LLRs of each non-zero block are rotated into
+ * a lane array and the check node update runs lane by lane (four at a time
+ * with SSE2). Decoding stops as soon as the hard decisions satisfy all
+ * parity checks.
+ */
+class ldpc_decoder
+{
+public:
+    ldpc_decoder();
+
+    /* llr: the n_avbits received soft bits of the DATA field, positive means
+     * 0. Writes the n_pld payload bits to out, packed MSB first. Returns
+     * false if a codeword did not converge. */
+    bool decode(const float* llr, uint8_t* out, const ldpc_param& param);
+
+    // iterations spent on the last frame
+    int iterations() const { return d_iterations; }
+
+private:
+    bool decode_codeword(const ldpc_code& code);
+    void update_layer(const ldpc_code& code, int row, float* r);
+    bool check(const ldpc_code& code);
+
+    // a posteriori LLRs of the codeword, one lane array per block column
+    alignas(16) float d_l[LDPC_BLOCK_COLS][LDPC_LANES];
+    // check to variable messages of every non-zero block
+    alignas(16) float d_r[LDPC_MAX_BLOCKS][LDPC_LANES];
+    // variable to check messages of the current layer
+    alignas(16) float d_t[LDPC_MAX_ROW_DEGREE][LDPC_LANES];
+
+    int d_iterations;
+};
+
+} // namespace ieee802_11
+} // namespace gr
+
+#endif /* INCLUDED_IEEE802_11_LDPC_DECODER_H */
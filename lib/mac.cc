@@ -24,31 +24,187 @@
 #if defined(__APPLE__)
 #include <architecture/byte_order.h>
 #define htole16(x) OSSwapHostToLittleInt16(x)
+#define le16toh(x) OSSwapLittleToHostInt16(x)
 #elif defined(_WIN32)
 #define htole16(x) (x)
+#define le16toh(x) (x)
 #else
 #include <endian.h>
 #endif
 
+#include <boost/chrono.hpp>
 #include <boost/crc.hpp>
+#include <algorithm>
+#include <cmath>
+#include <deque>
 #include <iostream>
+#include <map>
+#include <random>
 #include <stdexcept>
 
 using namespace gr::ieee802_11;
 
+#define FC_VERSION 0x0003
+#define FC_TYPE 0x000c
+#define FC_TYPE_SUBTYPE 0x00fc
+#define FC_DATA 0x0008
+#define FC_ACK 0x00d4
+#define FC_MORE_FRAGMENTS 0x0400
+#define FC_RETRY 0x0800
+// frame control, duration, receiver address and FCS
+#define ACK_SIZE 14
+// MSDUs reassembled at the same time, the oldest is dropped for a new one
+#define MAX_REASSEMBLY_ENTRIES 4
+// about dot11MaxReceiveLifetime (512 TU)
+#define REASSEMBLY_TIMEOUT boost::chrono::milliseconds(500)
+// rate control: weight of a new SNR sample, and how long it stays valid
+#define SNR_ALPHA 0.25
+#define SNR_LIFETIME boost::chrono::seconds(2)
+// rate control: headroom above the SNR an MCS needs, in dB
+#define RATE_MARGIN 2.0
+// S1G timing: OFDM symbol with normal GI, and DIFS = SIFS (160 us) + 2 slots
+#define SYMBOL_DURATION boost::chrono::microseconds(40)
+#define DIFS boost::chrono::microseconds(264)
+#define PREAMBLE_SYMBOLS (4 + NUM_OFDM_SYMBOLS_IN_LTF1 + NUM_OFDM_SYMBOLS_IN_SIG_FIELD)
+// queued MSDUs move up one access category per AGING_STEP of waiting
+#define AGING_STEP boost::chrono::milliseconds(20)
+
+namespace {
+
+// MCS from the most to the least robust one, with the SNR (dB) each needs for
+// about 10% PER on a 1 MHz channel with BCC. MCS10 has no LDPC, with LDPC
+// rate control starts at MCS0.
+const struct {
+    Encoding encoding;
+    double snr;
+} RATES[] = {
+    { BPSK_1_2_REP, -1.0 }, { BPSK_1_2, 2.0 },   { QPSK_1_2, 5.0 },
+    { QPSK_3_4, 8.0 },      { QAM16_1_2, 11.0 }, { QAM16_3_4, 14.5 },
+    { QAM64_2_3, 18.5 },    { QAM64_3_4, 20.0 }, { QAM64_5_6, 21.5 },
+    { QAM256_3_4, 25.5 },   { QAM256_5_6, 27.5 },
+};
+
+// EDCA access categories, highest priority first
+enum access_category { AC_VO, AC_VI, AC_BE, AC_BK, NUM_ACS };
+const char* const AC_NAMES[NUM_ACS] = { "VO", "VI", "BE", "BK" };
+// user priority (802.1D) to access category, Table 10-1
+const access_category UP_TO_AC[8] = { AC_BE, AC_BK, AC_BK, AC_BE,
+                                      AC_VI, AC_VI, AC_VO, AC_VO };
+// default S1G EDCA parameter set: AIFSN and contention window bounds
+const struct {
+    int aifsn;
+    int cw_min;
+    int cw_max;
+} EDCA[NUM_ACS] = { { 2, 3, 7 }, { 2, 7, 15 }, { 3, 15, 1023 }, { 7, 15, 1023 } };
+
+} // namespace
+
 class mac_impl : public mac
 {
+    struct reassembly {
+        std::vector<uint8_t> msdu;
+        int next_frag;
+        boost::chrono::steady_clock::time_point start;
+    };
+
+    // rate control statistics of a station
+    struct link {
+        double snr; // moving average, dB
+        boost::chrono::steady_clock::time_point updated;
+    };
+
+    struct queued_msdu {
+        std::vector<uint8_t> data;
+        int up; // user priority
+        boost::chrono::steady_clock::time_point arrival;
+    };
+
+    // TX queue of an access category
+    struct ac_queue {
+        std::deque<queued_msdu> msdus;
+        int limit = 0;
+        uint64_t sent = 0;
+        uint64_t dropped = 0;
+        double sojourn_sum = 0; // s
+        double sojourn_max = 0; // s
+        int cw = 0;             // contention window, slots
+        int backoff = -1;       // slots left, -1 if none is drawn
+    };
+
+    // what the receive path needs from a legacy or PV1 MAC header
+    struct rx_header {
+        int size;
+        bool data;
+        bool more_frags;
+        bool retry;
+        bool for_us;
+        const uint8_t* ta;
+        uint16_t seq_nr;
+    };
 
 public:
     mac_impl(std::vector<uint8_t> src_mac,
              std::vector<uint8_t> dst_mac,
-             std::vector<uint8_t> bss_mac)
+             std::vector<uint8_t> bss_mac,
+             int ampdu_size,
+             double ampdu_delay,
+             int frag_threshold,
+             bool arq,
+             int retry_limit,
+             double ack_timeout,
+             double loss_rate,
+             bool rate_control,
+             Encoding encoding,
+             std::vector<int> queue_limits,
+             bool short_header,
+             int aid,
+             bool ndp_ack,
+             bool csma,
+             double duty_cycle,
+             double duty_window,
+             bool sifs_ack,
+             bool ldpc)
         : block("mac", gr::io_signature::make(0, 0, 0), gr::io_signature::make(0, 0, 0)),
-          d_seq_nr(0)
+          d_seq_nr(0),
+          d_frag_threshold(frag_threshold),
+          d_ampdu_size(std::min(ampdu_size, MAX_AMPDU_SIZE)),
+          d_ampdu_delay(boost::chrono::duration_cast<boost::chrono::steady_clock::duration>(
+              boost::chrono::duration<double>(ampdu_delay))),
+          d_arq(arq),
+          d_retry_limit(retry_limit),
+          d_ack_timeout(boost::chrono::duration_cast<boost::chrono::steady_clock::duration>(
+              boost::chrono::duration<double>(ack_timeout))),
+          d_retries(0),
+          d_ack_id(0),
+          d_ndp_ack(ndp_ack),
+          d_sifs_ack(sifs_ack),
+          d_arq_ac(AC_BE),
+          d_arq_due(false),
+          d_loss_rate(loss_rate),
+          d_loss_rng(std::random_device()()),
+          d_rate_control(rate_control),
+          d_encoding(encoding),
+          d_ldpc(ldpc),
+          d_short_header(short_header),
+          d_aid(aid),
+          d_mpdu_overhead((short_header ? PV1_DATA_HEADER_SIZE : 24) + 4),
+          d_csma(csma),
+          d_rng(std::random_device()()),
+          d_cca_busy(false),
+          d_cca_sample(0),
+          d_idle_since(0),
+          d_duty_cycle(duty_cycle),
+          d_duty_window(boost::chrono::duration_cast<boost::chrono::steady_clock::duration>(
+              boost::chrono::duration<double>(duty_window))),
+          d_duty_budget(boost::chrono::duration_cast<boost::chrono::steady_clock::duration>(
+              boost::chrono::duration<double>(duty_cycle * duty_window))),
+          d_airtime_used(0),
+          d_finished(false)
     {
 
         message_port_register_out(pmt::mp("phy out"));
         message_port_register_out(pmt::mp("app out"));
+        message_port_register_out(pmt::mp("stats"));
 
         message_port_register_in(pmt::mp("app in"));
         set_msg_handler(pmt::mp("app in"),
@@ -58,18 +214,95 @@ public:
         set_msg_handler(pmt::mp("phy in"),
                         boost::bind(&mac_impl::phy_in, this, boost::placeholders::_1));
 
+        message_port_register_in(pmt::mp("cca"));
+        set_msg_handler(pmt::mp("cca"),
+                        boost::bind(&mac_impl::cca_in, this, boost::placeholders::_1));
+
         if (!check_mac(src_mac))
             throw std::invalid_argument("wrong mac address size");
         if (!check_mac(dst_mac))
             throw std::invalid_argument("wrong mac address size");
         if (!check_mac(bss_mac))
             throw std::invalid_argument("wrong mac address size");
+        if (frag_threshold < 256)
+            throw std::invalid_argument("fragmentation threshold below 256");
+        // without aggregation an MPDU is the whole PSDU
+        if (ampdu_size == 0 && frag_threshold > MAX_PSDU_SIZE)
+            throw std::invalid_argument("fragmentation threshold above 511 without A-MPDUs");
+        // acknowledging A-MPDUs would need Block Ack
+        if (arq && ampdu_size > 0)
+            throw std::invalid_argument("ARQ does not support A-MPDUs");
+        if (retry_limit < 0)
+            throw std::invalid_argument("negative retry limit");
+        if (ack_timeout <= 0)
+            throw std::invalid_argument("ACK timeout has to be positive");
+        if (loss_rate < 0 || loss_rate >= 1)
+            throw std::invalid_argument("loss rate has to be in [0, 1)");
+        if (encoding < BPSK_1_2 || encoding > BPSK_1_2_REP)
+            throw std::invalid_argument("invalid encoding");
+        if (ldpc && encoding == BPSK_1_2_REP)
+            throw std::invalid_argument("MCS10 does not support LDPC");
+        if (queue_limits.size() != NUM_ACS)
+            throw std::invalid_argument("one queue limit per access category (VO, VI, BE, BK)");
+        if (duty_cycle <= 0 || duty_cycle > 1)
+            throw std::invalid_argument("duty cycle has to be in (0, 1]");
+        if (duty_window <= 0)
+            throw std::invalid_argument("duty cycle window has to be positive");
+        // the ACKs of decode_mac do not go through the MAC
+        if (sifs_ack && duty_cycle < 1)
+            throw std::invalid_argument("duty cycle does not support SIFS ACKs");
 
         for (int i = 0; i < 6; i++) {
             d_src_mac[i] = src_mac[i];
             d_dst_mac[i] = dst_mac[i];
             d_bss_mac[i] = bss_mac[i];
         }
+
+        for (int ac = 0; ac < NUM_ACS; ac++) {
+            if (queue_limits[ac] < 1)
+                throw std::invalid_argument("queue limit below 1");
+            d_queues[ac].limit = queue_limits[ac];
+            d_queues[ac].cw = EDCA[ac].cw_min;
+        }
+
+        // PV1 data frames only go between the AP (the BSSID) and the station
+        d_ap = std::equal(d_src_mac, d_src_mac + 6, d_bss_mac);
+        if (short_header && !d_ap && !std::equal(d_dst_mac, d_dst_mac + 6, d_bss_mac))
+            throw std::invalid_argument(
+                "short MAC headers need the BSS MAC as source or destination");
+        if (short_header && (aid < 1 || aid > PV1_MAX_AID))
+            throw std::invalid_argument("AID has to be in [1, 8191]");
+
+        // airtime estimates
+        for (int e = BPSK_1_2; e <= BPSK_1_2_REP; e++) {
+            d_ofdm.push_back(ofdm_param(Encoding(e)));
+        }
+    }
+
+    bool start()
+    {
+        d_finished = false;
+        d_medium_free = boost::chrono::steady_clock::now();
+        // until the first CCA change, the sample clock starts now
+        d_cca_busy = false;
+        d_cca_sample = 0;
+        d_cca_wall = d_medium_free;
+        d_idle_since = 0;
+        d_timer_thread = gr::thread::thread(boost::bind(&mac_impl::handle_timeouts, this));
+        return block::start();
+    }
+
+    bool stop()
+    {
+        {
+            gr::thread::scoped_lock lock(d_mutex);
+            d_finished = true;
+        }
+        d_timer.notify_one();
+        if (d_timer_thread.joinable()) {
+            d_timer_thread.join();
+        }
+        return block::stop();
     }
 
     void phy_in(pmt::pmt_t msg)
@@ -79,21 +312,205 @@ public:
             throw std::runtime_error("PMT must be blob");
         }
 
-        // strip MAC header
-        // TODO: check for frame type to determine header size
+        // local channel model for loopback tests
+        if (d_loss_rate > 0 && d_uniform(d_loss_rng) < d_loss_rate) {
+            return;
+        }
+
+        // NDPs come straight from the frame equalizer
+        pmt::pmt_t ndp = pmt::is_dict(pmt::car(msg))
+                             ? pmt::dict_ref(pmt::car(msg), pmt::mp("ndp"), pmt::PMT_NIL)
+                             : pmt::PMT_NIL;
+        if (pmt::is_integer(ndp)) {
+            uint32_t body = pmt::to_long(ndp);
+            if (d_arq && ndp_field(body, 0, 3) == NDP_ACK) {
+                // the Ack ID tells whether it is for our frame
+                update_snr(pmt::car(msg), d_dst_mac);
+                ack_received(ndp_field(body, 3, NDP_ACK_ID_BITS));
+            }
+            return;
+        }
+
         pmt::pmt_t blob(pmt::cdr(msg));
-        const char* mpdu = reinterpret_cast<const char*>(pmt::blob_data(blob));
-        pmt::pmt_t msdu = pmt::make_blob(mpdu + 24, pmt::blob_length(blob) - 24);
+        const uint8_t* mpdu = reinterpret_cast<const uint8_t*>(pmt::blob_data(blob));
+        int len = pmt::blob_length(blob);
+        if (len < ACK_SIZE - 4) {
+            return;
+        }
+
+        const mac_header* header = reinterpret_cast<const mac_header*>(mpdu);
+        uint16_t frame_control = le16toh(header->frame_control);
+
+        if ((frame_control & (FC_VERSION | FC_TYPE_SUBTYPE)) == FC_ACK) {
+            if (d_arq && std::equal(header->addr1, header->addr1 + 6, d_src_mac)) {
+                // ACKs carry no transmitter address, this one is from our peer
+                update_snr(pmt::car(msg), d_dst_mac);
+                ack_received();
+            }
+            return;
+        }
+
+        rx_header h;
+        if (!parse_header(mpdu, len, h)) {
+            return;
+        }
+
+        update_snr(pmt::car(msg), h.ta);
+
+        // unicast data for us is acknowledged, unless decode_mac did already,
+        // retransmissions of a frame whose ACK got lost are not delivered again
+        if (d_arq && h.data && h.for_us) {
+            if (!d_sifs_ack) {
+                send_ack(h.ta, mpdu, len);
+            }
 
+            uint64_t ta = mac_key(h.ta);
+            auto last = d_last_seq.find(ta);
+            bool duplicate =
+                h.retry && last != d_last_seq.end() && last->second == h.seq_nr;
+            d_last_seq[ta] = h.seq_nr;
+            if (duplicate) {
+                return;
+            }
+        }
+
+        if (h.more_frags || (h.seq_nr & 0xf)) {
+            reassemble(pmt::car(msg), mpdu, len, h);
+            return;
+        }
+
+        pmt::pmt_t msdu = pmt::make_blob(mpdu + h.size, len - h.size);
         message_port_pub(pmt::mp("app out"), pmt::cons(pmt::car(msg), msdu));
     }
 
+    // false for frames that are too short and PV1 frames of other links
+    bool parse_header(const uint8_t* mpdu, int len, rx_header& h)
+    {
+        if ((mpdu[0] & FC_VERSION) == PV1_VERSION) {
+            pv1_header pv1;
+            if (!d_short_header || !parse_pv1_header(mpdu, len, pv1) ||
+                pv1.from_ds == d_ap || pv1.aid != d_aid ||
+                !std::equal(d_bss_mac, d_bss_mac + 6, pv1.bssid)) {
+                return false;
+            }
+            h.size = pv1.size;
+            h.data = true;
+            h.more_frags = pv1.frame_control & PV1_MORE_FRAGMENTS;
+            // there is no retry bit, a repeated sequence control is a duplicate
+            h.retry = true;
+            h.for_us = true;
+            // the SID stands for our peer
+            h.ta = d_dst_mac;
+            h.seq_nr = pv1.seq_nr;
+            return true;
+        }
+
+        if (len < 24) {
+            return false;
+        }
+        const mac_header* header = reinterpret_cast<const mac_header*>(mpdu);
+        uint16_t frame_control = le16toh(header->frame_control);
+        h.size = 24;
+        h.data = (frame_control & FC_TYPE) == FC_DATA;
+        h.more_frags = frame_control & FC_MORE_FRAGMENTS;
+        h.retry = frame_control & FC_RETRY;
+        h.for_us = std::equal(header->addr1, header->addr1 + 6, d_src_mac);
+        h.ta = header->addr2;
+        h.seq_nr = le16toh(header->seq_nr);
+        return true;
+    }
+
+    // collects the fragments of an MSDU, they have to arrive in order
+    void reassemble(pmt::pmt_t meta, const uint8_t* mpdu, int len, const rx_header& h)
+    {
+        int frag = h.seq_nr & 0xf;
+
+        // transmitter address and sequence number
+        uint64_t key = mac_key(h.ta) << 12 | h.seq_nr >> 4;
+
+        auto now = boost::chrono::steady_clock::now();
+        for (auto it = d_fragments.begin(); it != d_fragments.end();) {
+            if (now - it->second.start > REASSEMBLY_TIMEOUT) {
+                it = d_fragments.erase(it);
+            } else {
+                it++;
+            }
+        }
+
+        auto it = d_fragments.find(key);
+        if (frag == 0) {
+            if (it == d_fragments.end()) {
+                if (d_fragments.size() >= MAX_REASSEMBLY_ENTRIES) {
+                    d_fragments.erase(std::min_element(
+                        d_fragments.begin(), d_fragments.end(), [](auto& a, auto& b) {
+                            return a.second.start < b.second.start;
+                        }));
+                }
+                it = d_fragments.emplace(key, reassembly()).first;
+            }
+            it->second.msdu.clear();
+            it->second.next_frag = 0;
+            it->second.start = now;
+        } else if (it == d_fragments.end() || frag != it->second.next_frag) {
+            // a retransmission of the last fragment is ignored, a gap is fatal
+            if (it != d_fragments.end() && frag != it->second.next_frag - 1) {
+                d_fragments.erase(it);
+            }
+            return;
+        }
+
+        reassembly& r = it->second;
+        if (r.msdu.size() + len - h.size > MAX_PAYLOAD_SIZE) {
+            d_fragments.erase(it);
+            return;
+        }
+        r.msdu.insert(r.msdu.end(), mpdu + h.size, mpdu + len);
+        r.next_frag++;
+
+        if (!h.more_frags) {
+            pmt::pmt_t msdu = pmt::make_blob(r.msdu.data(), r.msdu.size());
+            message_port_pub(pmt::mp("app out"), pmt::cons(meta, msdu));
+            d_fragments.erase(it);
+        }
+    }
+
+    // clear channel assessment of the receiver, with the index of the sample
+    // where the medium turned busy or idle
+    void cca_in(pmt::pmt_t msg)
+    {
+        if (!pmt::is_dict(msg)) {
+            throw std::invalid_argument("CCA expects a dict");
+        }
+        bool busy = pmt::to_bool(pmt::dict_ref(msg, pmt::mp("busy"), pmt::PMT_F));
+        uint64_t sample = pmt::to_uint64(
+            pmt::dict_ref(msg, pmt::mp("sample"), pmt::from_uint64(0)));
+
+        gr::thread::scoped_lock lock(d_mutex);
+
+        // the change just happened, which anchors the sample clock
+        d_cca_sample = sample;
+        d_cca_wall = boost::chrono::steady_clock::now();
+
+        if (busy && !d_cca_busy) {
+            freeze(sample);
+        } else if (!busy) {
+            d_idle_since = std::max(d_idle_since, sample);
+        }
+        d_cca_busy = busy;
+
+        if (!busy) {
+            schedule();
+            d_timer.notify_one();
+        }
+    }
+
     void app_in(pmt::pmt_t msg)
     {
 
         size_t msg_len;
         const char* msdu;
         std::string str;
+        pmt::pmt_t meta = pmt::PMT_NIL;
 
         if (pmt::is_symbol(msg)) {
 
@@ -105,6 +522,7 @@ public:
 
             msg_len = pmt::blob_length(pmt::cdr(msg));
             msdu = reinterpret_cast<const char*>(pmt::blob_data(pmt::cdr(msg)));
+            meta = pmt::car(msg);
 
         } else {
             throw std::invalid_argument("MAC expects PDUs or strings");
@@ -115,27 +533,375 @@ public:
             throw std::invalid_argument("Frame too large (> 1500)");
         }
 
-        // make MAC frame
+        int up = classify(meta, reinterpret_cast<const uint8_t*>(msdu), msg_len);
+
+        gr::thread::scoped_lock lock(d_mutex);
+
+        ac_queue& q = d_queues[UP_TO_AC[up]];
+        if ((int)q.msdus.size() >= q.limit) {
+            q.dropped++;
+            publish_stats();
+            return;
+        }
+        q.msdus.push_back({ std::vector<uint8_t>(msdu, msdu + msg_len),
+                            up,
+                            boost::chrono::steady_clock::now() });
+
+        schedule();
+        d_timer.notify_one();
+    }
+
+    // user priority (0-7) from the metadata, or else from the DSCP of an IP
+    // packet behind LLC/SNAP
+    int classify(pmt::pmt_t meta, const uint8_t* msdu, int len)
+    {
+        if (pmt::is_dict(meta)) {
+            pmt::pmt_t up = pmt::dict_ref(meta, pmt::mp("priority"), pmt::PMT_NIL);
+            if (pmt::is_integer(up) && pmt::to_long(up) >= 0 && pmt::to_long(up) < 8) {
+                return pmt::to_long(up);
+            }
+        }
+
+        static const uint8_t snap[6] = { 0xaa, 0xaa, 0x03, 0x00, 0x00, 0x00 };
+        if (len < 10 || !std::equal(snap, snap + 6, msdu)) {
+            return 0;
+        }
+
+        int dscp;
+        if (msdu[6] == 0x08 && msdu[7] == 0x00 && (msdu[8] >> 4) == 4) {
+            dscp = msdu[9] >> 2;
+        } else if (msdu[6] == 0x86 && msdu[7] == 0xdd && (msdu[8] >> 4) == 6) {
+            dscp = ((msdu[8] & 0x0f) << 2) | (msdu[9] >> 6);
+        } else {
+            return 0;
+        }
+
+        // the class selector bits are the user priority
+        return dscp >> 3;
+    }
+
+    // starts the next transmission if the medium is free and nothing waits
+    // for an ACK, d_mutex has to be held
+    void schedule()
+    {
+        auto now = boost::chrono::steady_clock::now();
+        d_wakeup = boost::chrono::steady_clock::time_point::max();
+        if (d_finished || (!d_arq_queue.empty() && !d_arq_due)) {
+            return;
+        }
+        if (now < d_medium_free) {
+            d_wakeup = d_medium_free;
+            return;
+        }
+        if (d_csma && d_cca_busy) {
+            return;
+        }
+        uint64_t sample = now_sample(now);
+
+        // a retransmission or the next fragment waits for the budget, and a
+        // retransmission contends again, with its doubled window
+        if (d_arq_due) {
+            auto start = duty_free(arq_airtime(), now);
+            if (start == boost::chrono::steady_clock::time_point::max()) {
+                give_up();
+            } else if (start > now) {
+                d_wakeup = start;
+                return;
+            } else {
+                if (d_csma && !backoff_done(d_arq_ac, sample)) {
+                    return;
+                }
+                if (d_csma) {
+                    access(d_arq_ac, sample);
+                }
+                d_arq_due = false;
+                transmit_arq();
+                return;
+            }
+        }
+
+        // strict priority, but waiting MSDUs age into higher categories; among
+        // those that fit the airtime budget and, with CSMA/CA, whose backoff
+        // is over
+        int best = -1;
+        long best_rank = 0;
+        for (int ac = 0; ac < NUM_ACS; ac++) {
+            if (d_queues[ac].msdus.empty()) {
+                continue;
+            }
+            if (!ready(ac, now)) {
+                d_wakeup =
+                    std::min(d_wakeup, d_queues[ac].msdus.front().arrival + d_ampdu_delay);
+                continue;
+            }
+            auto start = duty_free(head_airtime(ac), now);
+            if (start == boost::chrono::steady_clock::time_point::max()) {
+                // longer than the whole budget, the next one might fit
+                d_queues[ac].msdus.pop_front();
+                d_queues[ac].dropped++;
+                d_wakeup = now;
+                continue;
+            }
+            if (start > now) {
+                d_wakeup = std::min(d_wakeup, start);
+                continue;
+            }
+            if (d_csma && !backoff_done(ac, sample)) {
+                continue;
+            }
+            long rank = ac - (now - d_queues[ac].msdus.front().arrival) / AGING_STEP;
+            if (best < 0 || rank < best_rank) {
+                best = ac;
+                best_rank = rank;
+            }
+        }
+        if (best < 0) {
+            return;
+        }
+
+        if (d_csma) {
+            access(best, sample);
+        }
+        transmit(best, now);
+        publish_stats();
+        d_wakeup = d_medium_free;
+    }
+
+    // the sample clock of the receiver, extrapolated from the last CCA change
+    uint64_t now_sample(boost::chrono::steady_clock::time_point now)
+    {
+        double elapsed = boost::chrono::duration<double>(now - d_cca_wall).count();
+        return d_cca_sample + std::llround(std::max(elapsed, 0.0) * SAMPLE_RATE);
+    }
+
+    static int aifs(int ac) { return SIFS_SAMPLES + EDCA[ac].aifsn * SLOT_SAMPLES; }
+
+    // draws a backoff for the access category if it has none, true once the
+    // medium was idle for AIFS and the backoff slots
+    bool backoff_done(int ac, uint64_t sample)
+    {
+        ac_queue& q = d_queues[ac];
+        if (q.backoff < 0) {
+            q.backoff = std::uniform_int_distribution<int>(0, q.cw)(d_rng);
+        }
+
+        uint64_t end = d_idle_since + aifs(ac) + uint64_t(q.backoff) * SLOT_SAMPLES;
+        if (sample >= end) {
+            return true;
+        }
+
+        double wait = double(end - d_cca_sample) / SAMPLE_RATE;
+        d_wakeup = std::min(
+            d_wakeup,
+            d_cca_wall + boost::chrono::duration_cast<boost::chrono::steady_clock::duration>(
+                             boost::chrono::duration<double>(wait)));
+        return false;
+    }
+
+    // the medium turns busy at sample: every backoff counts down the slots
+    // that passed idle after AIFS
+    void freeze(uint64_t sample)
+    {
+        for (int ac = 0; ac < NUM_ACS; ac++) {
+            ac_queue& q = d_queues[ac];
+            int64_t idle = int64_t(sample) - int64_t(d_idle_since) - aifs(ac);
+            if (q.backoff > 0 && idle > 0) {
+                q.backoff -= std::min<int64_t>(q.backoff, idle / SLOT_SAMPLES);
+            }
+        }
+    }
+
+    // the access category won the medium, its next frame draws a new backoff
+    void access(int ac, uint64_t sample)
+    {
+        freeze(sample);
+        d_queues[ac].backoff = -1;
+    }
+
+    // with aggregation, a queue waits until its MSDUs fill an A-MPDU or the
+    // oldest one used up the latency budget
+    bool ready(int ac, boost::chrono::steady_clock::time_point now)
+    {
+        const std::deque<queued_msdu>& msdus = d_queues[ac].msdus;
+        if (d_ampdu_size == 0 || now - msdus.front().arrival >= d_ampdu_delay) {
+            return true;
+        }
+
+        int encoding = tx_encoding();
+        int size = 0;
+        for (const queued_msdu& m : msdus) {
+            if (fragmented(m)) {
+                return true;
+            }
+            int start = (size + 3) & ~3;
+            if (!ampdu_fits(start + AMPDU_DELIMITER_SIZE + d_mpdu_overhead + m.data.size(),
+                            encoding)) {
+                return true;
+            }
+            size = start + AMPDU_DELIMITER_SIZE + d_mpdu_overhead + m.data.size();
+        }
+
+        // no room left for another MPDU with header and FCS
+        return !ampdu_fits(((size + 3) & ~3) + AMPDU_DELIMITER_SIZE + d_mpdu_overhead,
+                           encoding);
+    }
+
+    // an A-MPDU of size bytes stays within ampdu_size and the 511 symbols
+    // the PHY accepts at the encoding
+    bool ampdu_fits(int size, int encoding)
+    {
+        return size <= d_ampdu_size && symbols(size, encoding, true, true) <= MAX_AMPDU_SYM;
+    }
+
+    bool fragmented(const queued_msdu& m)
+    {
+        return d_mpdu_overhead + (int)m.data.size() > d_frag_threshold;
+    }
+
+    // takes the MSDU at the head of the queue and updates the statistics
+    queued_msdu dequeue(int ac, boost::chrono::steady_clock::time_point now)
+    {
+        ac_queue& q = d_queues[ac];
+        queued_msdu m = std::move(q.msdus.front());
+        q.msdus.pop_front();
+
+        double sojourn = boost::chrono::duration<double>(now - m.arrival).count();
+        q.sent++;
+        q.sojourn_sum += sojourn;
+        q.sojourn_max = std::max(q.sojourn_max, sojourn);
+        return m;
+    }
+
+    // sends the next PPDU of the access category, d_mutex has to be held
+    void transmit(int ac, boost::chrono::steady_clock::time_point now)
+    {
+        queued_msdu m = dequeue(ac, now);
+
+        std::deque<std::vector<uint8_t>> mpdus;
+        make_mpdus(m, mpdus);
+
+        if (d_arq && !(d_dst_mac[0] & 1)) {
+            d_arq_ac = ac;
+            d_arq_queue = std::move(mpdus);
+            transmit_arq();
+            return;
+        }
+
+        if (d_ampdu_size == 0 || mpdus.size() > 1) {
+            // fragments are sent back to back, they do not go into an A-MPDU
+            for (auto& mpdu : mpdus) {
+                send_mpdu(mpdu);
+            }
+            return;
+        }
+
+        // fill the A-MPDU with what is queued behind
+        int encoding = tx_encoding();
+        d_ampdu.clear();
+        int n_mpdus = 0;
+        while (true) {
+            int start = (d_ampdu.size() + 3) & ~3;
+            d_ampdu.resize(start + AMPDU_DELIMITER_SIZE + mpdus[0].size(), 0);
+            ampdu_delimiter(&d_ampdu[start], mpdus[0].size(), false);
+            std::memcpy(
+                &d_ampdu[start + AMPDU_DELIMITER_SIZE], mpdus[0].data(), mpdus[0].size());
+            n_mpdus++;
+
+            std::deque<queued_msdu>& q = d_queues[ac].msdus;
+            if (q.empty() || fragmented(q.front())) {
+                break;
+            }
+            int size = ((d_ampdu.size() + 3) & ~3) + AMPDU_DELIMITER_SIZE +
+                       d_mpdu_overhead + q.front().data.size();
+            if (!ampdu_fits(size, encoding) ||
+                duty_free(airtime(size, encoding, true, true), now) > now) {
+                break;
+            }
+            m = dequeue(ac, now);
+            mpdus.clear();
+            make_mpdus(m, mpdus);
+        }
+
+        send_ampdu(n_mpdus);
+    }
+
+    // MPDUs of an MSDU, more than one if it has to be fragmented
+    void make_mpdus(const queued_msdu& m, std::deque<std::vector<uint8_t>>& mpdus)
+    {
+        const char* msdu = reinterpret_cast<const char*>(m.data.data());
+        int msg_len = m.data.size();
         int psdu_length;
-        generate_mac_data_frame(msdu, msg_len, &psdu_length);
+
+        // MPDUs above the threshold are split into fragments of equal, even
+        // size that share the sequence number
+        int frag_size = fragmented(m) ? (d_frag_threshold - d_mpdu_overhead) & ~1 : msg_len;
+
+        int frag = 0;
+        do {
+            int size = std::min(frag_size, msg_len - frag * frag_size);
+            bool more = (frag + 1) * frag_size < msg_len;
+            generate_mac_data_frame(
+                msdu + frag * frag_size, size, &psdu_length, m.up, frag, more);
+            mpdus.emplace_back(d_psdu, d_psdu + psdu_length);
+            frag++;
+        } while (frag * frag_size < msg_len);
+
+        d_seq_nr++;
+    }
+
+    // sends an MPDU on its own, d_mutex has to be held
+    void send_mpdu(const std::vector<uint8_t>& mpdu, int fallback = 0)
+    {
+        int encoding = tx_encoding(fallback);
 
         // dict
         pmt::pmt_t dict = pmt::make_dict();
         dict = pmt::dict_add(dict, pmt::mp("crc_included"), pmt::PMT_T);
+        if (encoding >= 0) {
+            dict = pmt::dict_add(dict, pmt::mp("encoding"), pmt::from_long(encoding));
+        }
 
         // blob
-        pmt::pmt_t mac = pmt::make_blob(d_psdu, psdu_length);
+        pmt::pmt_t mac = pmt::make_blob(mpdu.data(), mpdu.size());
 
         // pdu
         message_port_pub(pmt::mp("phy out"), pmt::cons(dict, mac));
+
+        occupy_medium(airtime(mpdu.size(), encoding, false),
+                      airtime(mpdu.size(), encoding, false, true));
     }
 
-    void generate_mac_data_frame(const char* msdu, int msdu_size, int* psdu_size)
+    void generate_mac_data_frame(const char* msdu,
+                                 int msdu_size,
+                                 int* psdu_size,
+                                 int up = 0,
+                                 int frag = 0,
+                                 bool more_frags = false)
     {
+        uint16_t seq_nr = frag | (d_seq_nr & 0xfff) << 4;
+        int header_size = 24;
+
+        if (d_short_header) {
+            // the user priority is the TID of the QoS data frame
+            header_size = write_pv1_header(
+                d_psdu, up, d_ap, d_aid, d_bss_mac, seq_nr, more_frags);
+        } else {
+            write_legacy_header(seq_nr, more_frags);
+        }
+
+        *psdu_size = header_size + msdu_size + 4;
+
+        // copy msdu into psdu
+        memcpy(d_psdu + header_size, msdu, msdu_size);
+        // compute and store fcs
+        set_fcs(d_psdu, *psdu_size);
+    }
 
+    void write_legacy_header(uint16_t seq_nr, bool more_frags)
+    {
         // mac header
         mac_header header;
-        header.frame_control = 0x0008;
+        header.frame_control = htole16(FC_DATA | (more_frags ? FC_MORE_FRAGMENTS : 0));
         header.duration = 0x0000;
 
         for (int i = 0; i < 6; i++) {
@@ -144,38 +910,410 @@ public:
             header.addr3[i] = d_bss_mac[i];
         }
 
-        header.seq_nr = 0;
-        for (int i = 0; i < 12; i++) {
-            if (d_seq_nr & (1 << i)) {
-                header.seq_nr |= (1 << (i + 4));
+        header.seq_nr = htole16(seq_nr);
+
+        // copy mac header into psdu
+        std::memcpy(d_psdu, &header, 24);
+    }
+
+    // sends the A-MPDU in d_ampdu, d_mutex has to be held
+    void send_ampdu(int n_mpdus)
+    {
+        // a single MPDU goes out as S-MPDU
+        if (n_mpdus == 1) {
+            int len = d_ampdu.size() - AMPDU_DELIMITER_SIZE;
+            ampdu_delimiter(&d_ampdu[0], len, true);
+        }
+
+        int encoding = tx_encoding();
+
+        pmt::pmt_t dict = pmt::make_dict();
+        dict = pmt::dict_add(dict, pmt::mp("crc_included"), pmt::PMT_T);
+        dict = pmt::dict_add(dict, pmt::mp("aggregation"), pmt::PMT_T);
+        if (encoding >= 0) {
+            dict = pmt::dict_add(dict, pmt::mp("encoding"), pmt::from_long(encoding));
+        }
+
+        pmt::pmt_t mac = pmt::make_blob(d_ampdu.data(), d_ampdu.size());
+        message_port_pub(pmt::mp("phy out"), pmt::cons(dict, mac));
+
+        occupy_medium(airtime(d_ampdu.size(), encoding, true),
+                      airtime(d_ampdu.size(), encoding, true, true));
+    }
+
+    // (re)transmits the head of the ARQ queue, d_mutex has to be held
+    void transmit_arq()
+    {
+        const std::vector<uint8_t>& mpdu = d_arq_queue.front();
+        d_ack_id = ndp_ack_id(mpdu.data(), mpdu.size() - 4);
+
+        // every retry falls back to a more robust MCS
+        send_mpdu(mpdu, d_retries);
+
+        // the ACK cannot come before the end of the frame
+        d_ack_from = d_medium_free - DIFS;
+        d_ack_deadline = d_medium_free + d_ack_timeout;
+        d_timer.notify_one();
+    }
+
+    // ack_id is the Ack ID of an NDP ACK, -1 for an ACK frame
+    void ack_received(int ack_id = -1)
+    {
+        gr::thread::scoped_lock lock(d_mutex);
+
+        // late ACK of a frame that was given up already
+        if (d_arq_queue.empty() || (ack_id >= 0 && ack_id != d_ack_id)) {
+            return;
+        }
+
+        // an ACK frame does not say which MPDU it is for, one that comes while
+        // the MPDU is still on the air is a late duplicate for the previous one
+        auto now = boost::chrono::steady_clock::now();
+        if (ack_id < 0 && now < d_ack_from) {
+            return;
+        }
+
+        // the exchange is over, the medium is free after DIFS
+        d_medium_free = now + DIFS;
+
+        d_arq_queue.pop_front();
+        d_retries = 0;
+        d_arq_due = false;
+        d_queues[d_arq_ac].cw = EDCA[d_arq_ac].cw_min;
+        if (!d_arq_queue.empty() && duty_free(arq_airtime(), now) <= now) {
+            transmit_arq();
+        } else {
+            // the next fragment waits for the airtime budget
+            d_arq_due = !d_arq_queue.empty();
+            schedule();
+            d_timer.notify_one();
+        }
+    }
+
+    // no ACK within the timeout, d_mutex has to be held
+    void ack_timeout()
+    {
+        std::vector<uint8_t>& mpdu = d_arq_queue.front();
+
+        if (d_retries++ < d_retry_limit) {
+            // PV1 frames have no retry bit
+            if (!d_short_header) {
+                mpdu[1] |= FC_RETRY >> 8;
+                set_fcs(mpdu.data(), mpdu.size());
+            }
+            if (d_csma) {
+                // maybe a collision, back off with a doubled window
+                ac_queue& q = d_queues[d_arq_ac];
+                q.cw = std::min(2 * q.cw + 1, EDCA[d_arq_ac].cw_max);
+                q.backoff = -1;
             }
+            if (d_csma || d_duty_cycle < 1) {
+                d_arq_due = true;
+                schedule();
+                return;
+            }
+            transmit_arq();
+            return;
         }
-        header.seq_nr = htole16(header.seq_nr);
-        d_seq_nr++;
 
-        // header size is 24, plus 4 for FCS means 28 bytes
-        *psdu_size = 28 + msdu_size;
+        give_up();
+        schedule();
+    }
 
-        // copy mac header into psdu
-        std::memcpy(d_psdu, &header, 24);
-        // copy msdu into psdu
-        memcpy(d_psdu + 24, msdu, msdu_size);
-        // compute and store fcs
+    // the remaining fragments of the MSDU on the air are useless without
+    // this one, d_mutex has to be held
+    void give_up()
+    {
+        d_arq_queue.clear();
+        d_retries = 0;
+        d_arq_due = false;
+        d_queues[d_arq_ac].cw = EDCA[d_arq_ac].cw_min;
+    }
+
+    // acknowledges the MPDU (without FCS) from ra
+    void send_ack(const uint8_t* ra, const uint8_t* mpdu, int len)
+    {
+        gr::thread::scoped_lock lock(d_mutex);
+
+        // an ACK cannot wait, without budget the sender has to retry later
+        auto now = boost::chrono::steady_clock::now();
+        int encoding = default_encoding();
+        boost::chrono::steady_clock::duration ack_airtime =
+            d_ndp_ack ? PREAMBLE_SYMBOLS * SYMBOL_DURATION
+                      : airtime(ACK_SIZE, encoding, false, true);
+        if (duty_free(ack_airtime, now) > now) {
+            return;
+        }
+
+        if (d_ndp_ack) {
+            pmt::pmt_t dict = pmt::make_dict();
+            dict = pmt::dict_add(
+                dict, pmt::mp("ndp"), pmt::from_long(ndp_ack(ndp_ack_id(mpdu, len))));
+            message_port_pub(pmt::mp("phy out"),
+                             pmt::cons(dict, pmt::make_blob(nullptr, 0)));
+
+            occupy_medium(ack_airtime, ack_airtime);
+            return;
+        }
+
+        uint8_t ack[ACK_SIZE];
+        uint16_t frame_control = htole16(FC_ACK);
+        std::memcpy(ack, &frame_control, 2);
+        ack[2] = ack[3] = 0;
+        std::memcpy(ack + 4, ra, 6);
+        set_fcs(ack, ACK_SIZE);
+
+        pmt::pmt_t dict = pmt::make_dict();
+        dict = pmt::dict_add(dict, pmt::mp("crc_included"), pmt::PMT_T);
+        if (encoding >= 0) {
+            dict = pmt::dict_add(dict, pmt::mp("encoding"), pmt::from_long(encoding));
+        }
+        pmt::pmt_t mac = pmt::make_blob(ack, ACK_SIZE);
+        message_port_pub(pmt::mp("phy out"), pmt::cons(dict, mac));
+
+        occupy_medium(airtime(ACK_SIZE, encoding, false), ack_airtime);
+    }
+
+    // airtime of a PPDU, frames without an encoding go out with the PHY
+    // default. The PHY might use LDPC, with worst_case the longer of BCC and
+    // LDPC counts. The short GI only makes frames shorter.
+    boost::chrono::steady_clock::duration
+    airtime(int psdu_length, int encoding, bool aggregation, bool worst_case = false)
+    {
+        return (PREAMBLE_SYMBOLS + symbols(psdu_length, encoding, aggregation, worst_case)) *
+               SYMBOL_DURATION;
+    }
+
+    // DATA symbols of a PPDU, worst_case as for airtime()
+    int symbols(int psdu_length, int encoding, bool aggregation, bool worst_case)
+    {
+        ofdm_param& ofdm = d_ofdm[encoding < 0 ? d_encoding : encoding];
+        int n_sym = frame_param(ofdm, psdu_length, false, aggregation).n_sym;
+        if (worst_case && ofdm.encoding != BPSK_1_2_REP) {
+            n_sym = std::max(n_sym, frame_param(ofdm, psdu_length, true, aggregation).n_sym);
+        }
+        return n_sym;
+    }
+
+    // worst case airtime of the PPDUs of the MSDU at the head of the queue,
+    // all fragments or an A-MPDU with just this MSDU
+    boost::chrono::steady_clock::duration head_airtime(int ac)
+    {
+        const queued_msdu& m = d_queues[ac].msdus.front();
+        int encoding = tx_encoding();
+        if (d_ampdu_size > 0 && !fragmented(m)) {
+            return airtime(AMPDU_DELIMITER_SIZE + d_mpdu_overhead + m.data.size(),
+                           encoding,
+                           true,
+                           true);
+        }
+
+        // same split as make_mpdus
+        int msg_len = m.data.size();
+        int frag_size = fragmented(m) ? (d_frag_threshold - d_mpdu_overhead) & ~1 : msg_len;
+        boost::chrono::steady_clock::duration total(0);
+        int frag = 0;
+        do {
+            int size = std::min(frag_size, msg_len - frag * frag_size);
+            total += airtime(d_mpdu_overhead + size, encoding, false, true);
+            frag++;
+        } while (frag * frag_size < msg_len);
+        return total;
+    }
+
+    // worst case airtime of the next (re)transmission of the ARQ queue
+    boost::chrono::steady_clock::duration arq_airtime()
+    {
+        return airtime(d_arq_queue.front().size(), tx_encoding(d_retries), false, true);
+    }
+
+    // earliest start of a PPDU with the given airtime that keeps the airtime
+    // of every window within the budget, max() if it never fits. PPDUs count
+    // in full as long as any part of them is in the window.
+    boost::chrono::steady_clock::time_point
+    duty_free(boost::chrono::steady_clock::duration airtime,
+              boost::chrono::steady_clock::time_point now)
+    {
+        if (d_duty_cycle >= 1) {
+            return now;
+        }
+        if (airtime > d_duty_budget) {
+            return boost::chrono::steady_clock::time_point::max();
+        }
+
+        // the window that ends with the new PPDU has to drop the oldest ones
+        auto start = now;
+        auto used = d_airtime_used;
+        for (const auto& ppdu : d_airtime_log) {
+            if (used + airtime <= d_duty_budget) {
+                break;
+            }
+            start = std::max(start, ppdu.first + d_duty_window - airtime);
+            used -= ppdu.second;
+        }
+        return start;
+    }
+
+    // forgets the PPDUs that ended before the current window
+    void expire_airtime(boost::chrono::steady_clock::time_point now)
+    {
+        while (!d_airtime_log.empty() && d_airtime_log.front().first + d_duty_window <= now) {
+            d_airtime_used -= d_airtime_log.front().second;
+            d_airtime_log.pop_front();
+        }
+    }
+
+    // marks the medium busy for the frame and the following DIFS, and charges
+    // the airtime budget with the worst case airtime of the frame
+    void occupy_medium(boost::chrono::steady_clock::duration airtime,
+                       boost::chrono::steady_clock::duration charged)
+    {
+        auto now = boost::chrono::steady_clock::now();
+        auto start = std::max(d_medium_free, now);
+        d_medium_free = start + airtime + DIFS;
+
+        if (d_duty_cycle < 1) {
+            expire_airtime(now);
+            d_airtime_log.emplace_back(start + charged, charged);
+            d_airtime_used += charged;
+        }
+
+        // AIFS and backoff count from the end of the frame
+        if (d_csma) {
+            uint64_t end = now_sample(now) +
+                           std::llround(boost::chrono::duration<double>(airtime).count() *
+                                        SAMPLE_RATE);
+            d_idle_since = std::max(d_idle_since, end);
+        }
+    }
+
+    // publishes depth, drops and sojourn times of all access categories
+    void publish_stats()
+    {
+        pmt::pmt_t stats = pmt::make_dict();
+        for (int ac = 0; ac < NUM_ACS; ac++) {
+            const ac_queue& q = d_queues[ac];
+            pmt::pmt_t s = pmt::make_dict();
+            s = pmt::dict_add(s, pmt::mp("depth"), pmt::from_long(q.msdus.size()));
+            s = pmt::dict_add(s, pmt::mp("sent"), pmt::from_uint64(q.sent));
+            s = pmt::dict_add(s, pmt::mp("dropped"), pmt::from_uint64(q.dropped));
+            s = pmt::dict_add(s,
+                              pmt::mp("sojourn mean"),
+                              pmt::from_double(q.sent ? q.sojourn_sum / q.sent : 0));
+            s = pmt::dict_add(s, pmt::mp("sojourn max"), pmt::from_double(q.sojourn_max));
+            if (d_csma) {
+                s = pmt::dict_add(s, pmt::mp("cw"), pmt::from_long(q.cw));
+            }
+            stats = pmt::dict_add(stats, pmt::mp(AC_NAMES[ac]), s);
+        }
+        if (d_duty_cycle < 1) {
+            expire_airtime(boost::chrono::steady_clock::now());
+            stats = pmt::dict_add(
+                stats,
+                pmt::mp("airtime used"),
+                pmt::from_double(boost::chrono::duration<double>(d_airtime_used).count()));
+        }
+        message_port_pub(pmt::mp("stats"), stats);
+    }
+
+    // handles ACK timeouts and starts transmissions once the medium is free,
+    // an A-MPDU used up its latency budget, a backoff is over or the airtime
+    // budget allows
+    void handle_timeouts()
+    {
+        gr::thread::scoped_lock lock(d_mutex);
+
+        while (!d_finished) {
+            auto now = boost::chrono::steady_clock::now();
+            if (!d_arq_queue.empty() && !d_arq_due && now >= d_ack_deadline) {
+                ack_timeout();
+                continue;
+            }
+
+            schedule();
+
+            // schedule() knows when it wants to run next, a busy medium
+            // turning idle notifies the timer
+            auto next = d_wakeup;
+            if (!d_arq_queue.empty() && !d_arq_due) {
+                next = d_ack_deadline;
+            }
+
+            if (next == boost::chrono::steady_clock::time_point::max()) {
+                d_timer.wait(lock);
+            } else {
+                d_timer.wait_until(lock, next);
+            }
+        }
+    }
+
+    // MCS picked by rate control for the next frame to the destination, -1
+    // leaves the choice to the PHY, d_mutex has to be held
+    int tx_encoding(int fallback = 0)
+    {
+        if (!d_rate_control) {
+            return default_encoding();
+        }
+        auto link = d_links.find(mac_key(d_dst_mac));
+        if (link == d_links.end() ||
+            boost::chrono::steady_clock::now() - link->second.updated > SNR_LIFETIME) {
+            return default_encoding();
+        }
+
+        // neither rate control nor ARQ retries go below MCS0 with LDPC
+        int floor = d_ldpc ? 1 : 0;
+        int rate = floor;
+        while (rate + 1 < int(sizeof(RATES) / sizeof(RATES[0])) &&
+               RATES[rate + 1].snr + RATE_MARGIN <= link->second.snr) {
+            rate++;
+        }
+        return RATES[std::max(rate - fallback, floor)].encoding;
+    }
+
+    // the airtime budget is charged at the PHY default encoding, with a duty
+    // cycle the PHY must not pick another one
+    int default_encoding() { return d_duty_cycle < 1 ? d_encoding : -1; }
+
+    // the channel is assumed to be reciprocal, so the SNR of the frames from
+    // a station is used to pick the MCS of the frames to it
+    void update_snr(pmt::pmt_t meta, const uint8_t* addr)
+    {
+        if (!d_rate_control || !pmt::is_dict(meta)) {
+            return;
+        }
+        pmt::pmt_t snr = pmt::dict_ref(meta, pmt::mp("snr"), pmt::PMT_NIL);
+        if (!pmt::is_real(snr) || !std::isfinite(pmt::to_double(snr))) {
+            return;
+        }
+
+        gr::thread::scoped_lock lock(d_mutex);
+        auto now = boost::chrono::steady_clock::now();
+        auto link = d_links.find(mac_key(addr));
+        if (link == d_links.end() || now - link->second.updated > SNR_LIFETIME) {
+            d_links[mac_key(addr)] = { pmt::to_double(snr), now };
+        } else {
+            link->second.snr += SNR_ALPHA * (pmt::to_double(snr) - link->second.snr);
+            link->second.updated = now;
+        }
+    }
+
+    // computes the FCS over everything but the last four bytes
+    static void set_fcs(uint8_t* mpdu, int len)
+    {
         boost::crc_32_type result;
-        result.process_bytes(d_psdu, msdu_size + 24);
+        result.process_bytes(mpdu, len - 4);
 
         uint32_t fcs = result.checksum();
-        memcpy(d_psdu + msdu_size + 24, &fcs, sizeof(uint32_t));
-
-        //std::cout << "FCS : " << unsigned(fcs) << std::endl;
+        std::memcpy(mpdu + len - 4, &fcs, sizeof(uint32_t));
+    }
 
-        /*
-        std::cout << "Header : ";
-        for(int i = 0; i < 24; i++){
-            std::cout << unsigned(d_psdu[i]) << ",";
+    static uint64_t mac_key(const uint8_t* addr)
+    {
+        uint64_t key = 0;
+        for (int i = 0; i < 6; i++) {
+            key |= uint64_t(addr[i]) << (8 * i);
         }
-        std::cout << std::endl;
-        */
+        return key;
     }
 
     bool check_mac(std::vector<uint8_t> mac)
@@ -187,15 +1325,135 @@ public:
 
 private:
     uint16_t d_seq_nr;
+    int d_frag_threshold;
+    // MSDUs being reassembled, by transmitter address and sequence number
+    std::map<uint64_t, reassembly> d_fragments;
     uint8_t d_src_mac[6];
     uint8_t d_dst_mac[6];
     uint8_t d_bss_mac[6];
-    uint8_t d_psdu[MAX_PSDU_SIZE];
+    // MAC header, payload and FCS
+    uint8_t d_psdu[MAX_PAYLOAD_SIZE + 28];
+
+    ac_queue d_queues[NUM_ACS];
+    // end of the current transmission (plus DIFS) as far as we know
+    boost::chrono::steady_clock::time_point d_medium_free;
+
+    int d_ampdu_size;
+    boost::chrono::steady_clock::duration d_ampdu_delay;
+    std::vector<uint8_t> d_ampdu;
+
+    // stop-and-wait ARQ, the MPDUs of the MSDU on the air
+    bool d_arq;
+    int d_retry_limit;
+    boost::chrono::steady_clock::duration d_ack_timeout;
+    std::deque<std::vector<uint8_t>> d_arq_queue;
+    int d_retries;
+    // ACKs of the MPDU on the air are accepted from d_ack_from on
+    boost::chrono::steady_clock::time_point d_ack_from;
+    boost::chrono::steady_clock::time_point d_ack_deadline;
+    // Ack ID an NDP ACK of the MPDU on the air carries
+    int d_ack_id;
+    bool d_ndp_ack;
+    // decode_mac acknowledges within SIFS, the MAC does not
+    bool d_sifs_ack;
+    // access category of the MSDU on the air, and whether its retry waits
+    // for the medium
+    int d_arq_ac;
+    bool d_arq_due;
+    // last sequence control field per transmitter, to drop duplicates
+    std::map<uint64_t, uint16_t> d_last_seq;
+
+    // the loss model runs in phy_in without d_mutex, it has its own generator
+    double d_loss_rate;
+    std::mt19937 d_loss_rng;
+    std::uniform_real_distribution<double> d_uniform;
+
+    bool d_rate_control;
+    std::map<uint64_t, link> d_links;
+
+    // PHY default encoding and parameters of all encodings, for airtimes
+    Encoding d_encoding;
+    // the PHY codes with LDPC, which MCS10 does not support
+    bool d_ldpc;
+    std::vector<ofdm_param> d_ofdm;
+
+    // PV1 headers, the station of the link is addressed by its AID
+    bool d_short_header;
+    int d_aid;
+    bool d_ap;
+    // MAC header and FCS of a data frame
+    int d_mpdu_overhead;
+
+    // CSMA/CA, EDCA backoff in slots on the sample clock of the receiver,
+    // drawn with d_mutex held
+    bool d_csma;
+    std::mt19937 d_rng;
+    bool d_cca_busy;
+    // the last CCA change, at sample d_cca_sample, came in at d_cca_wall
+    uint64_t d_cca_sample;
+    boost::chrono::steady_clock::time_point d_cca_wall;
+    // first sample of the current idle period
+    uint64_t d_idle_since;
+    // when schedule() wants to run again, for the timer
+    boost::chrono::steady_clock::time_point d_wakeup;
+
+    // duty cycle, the airtime of the PPDUs (end and worst case airtime) that
+    // may still be in the sliding window
+    double d_duty_cycle;
+    boost::chrono::steady_clock::duration d_duty_window;
+    boost::chrono::steady_clock::duration d_duty_budget;
+    std::deque<std::pair<boost::chrono::steady_clock::time_point,
+                         boost::chrono::steady_clock::duration>>
+        d_airtime_log;
+    boost::chrono::steady_clock::duration d_airtime_used;
+
+    gr::thread::mutex d_mutex;
+    gr::thread::condition_variable d_timer;
+    gr::thread::thread d_timer_thread;
+    bool d_finished;
 };
 
 mac::sptr mac::make(std::vector<uint8_t> src_mac,
                     std::vector<uint8_t> dst_mac,
-                    std::vector<uint8_t> bss_mac)
+                    std::vector<uint8_t> bss_mac,
+                    int ampdu_size,
+                    double ampdu_delay,
+                    int frag_threshold,
+                    bool arq,
+                    int retry_limit,
+                    double ack_timeout,
+                    double loss_rate,
+                    bool rate_control,
+                    Encoding encoding,
+                    std::vector<int> queue_limits,
+                    bool short_header,
+                    int aid,
+                    bool ndp_ack,
+                    bool csma,
+                    double duty_cycle,
+                    double duty_window,
+                    bool sifs_ack,
+                    bool ldpc)
 {
-    return gnuradio::get_initial_sptr(new mac_impl(src_mac, dst_mac, bss_mac));
+    return gnuradio::get_initial_sptr(new mac_impl(src_mac,
+                                                   dst_mac,
+                                                   bss_mac,
+                                                   ampdu_size,
+                                                   ampdu_delay,
+                                                   frag_threshold,
+                                                   arq,
+                                                   retry_limit,
+                                                   ack_timeout,
+                                                   loss_rate,
+                                                   rate_control,
+                                                   encoding,
+                                                   queue_limits,
+                                                   short_header,
+                                                   aid,
+                                                   ndp_ack,
+                                                   csma,
+                                                   duty_cycle,
+                                                   duty_window,
+                                                   sifs_ack,
+                                                   ldpc));
 }
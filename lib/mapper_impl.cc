@@ -26,14 +26,15 @@ class mapper_impl : public mapper
 public:
     static const int DATA_CARRIERS = CODED_BITS_PER_OFDM_SYMBOL;
 
-    mapper_impl(Encoding e, bool debug)
+    mapper_impl(Encoding e, bool debug, bool ldpc)
         : block("mapper",
                 gr::io_signature::make(0, 0, 0),
                 gr::io_signature::make(1, 1, sizeof(char))),
           d_symbols_offset(0),
-          d_symbols(NULL),
           d_debug(debug),
           d_scrambler(1),
+          d_ldpc(ldpc),
+          d_encoding(e),
           d_ofdm(e)
     {
 
@@ -41,8 +42,6 @@ public:
         set_encoding(e);
     }
 
-    ~mapper_impl() { free(d_symbols); }
-
     void print_message(const char* msg, size_t len)
     {
 
@@ -79,69 +78,37 @@ public:
                 dout << "MAPPER: received new message" << std::endl;
                 gr::thread::scoped_lock lock(d_mutex);
 
-                int psdu_length = pmt::blob_length(pmt::cdr(msg));
-                const char* psdu =
-                    static_cast<const char*>(pmt::blob_data(pmt::cdr(msg)));
-
-                // ############ INSERT MAC STUFF
-                frame_param frame(d_ofdm, psdu_length);
-                if (frame.n_sym > MAX_SYM) {
-                    std::cout << "packet too large, maximum number of symbols is "
-                              << MAX_SYM << std::endl;
-                    return 0;
+                // NDPs have no DATA field, the tagged stream cannot carry them
+                if (pmt::is_dict(pmt::car(msg)) &&
+                    pmt::dict_has_key(pmt::car(msg), pmt::mp("ndp"))) {
+                    std::cout << "NDPs need the OFDM modulator, dropping packet"
+                              << std::endl;
+                    continue;
                 }
 
-                // alloc memory for modulation steps
-                char* data_bits = (char*)calloc(frame.n_data_bits, sizeof(char));
-                char* scrambled_data = (char*)calloc(frame.n_data_bits, sizeof(char));
-                char* encoded_data = (char*)calloc(frame.n_data_bits * 2, sizeof(char));
-                char* punctured_data = (char*)calloc(frame.n_encoded_bits, sizeof(char));
-                char* repeated_data;
-                char* interleaved_data;
-                char* symbols;
-
-                if(d_ofdm.encoding == gr::ieee802_11::BPSK_1_2_REP){
-                    repeated_data = (char*)calloc(frame.n_encoded_bits * 2, sizeof(char));
-                    interleaved_data = (char*)calloc(frame.n_encoded_bits * 2, sizeof(char));
-                    symbols = (char*)calloc((frame.n_encoded_bits / d_ofdm.n_bpsc) * 2, sizeof(char));
-                }
-                else{
-                    interleaved_data =(char*)calloc(frame.n_encoded_bits, sizeof(char));
-                    symbols =(char*)calloc((frame.n_encoded_bits / d_ofdm.n_bpsc), sizeof(char));
+                tx_psdu psdu(d_ofdm);
+                std::string error =
+                    prepare_psdu(msg, d_encoding, d_ldpc, d_ofdm, d_psdu, psdu);
+                if (!error.empty()) {
+                    std::cout << error << ", dropping packet" << std::endl;
+                    continue;
                 }
 
-
-                // generate the WIFI data field, adding service field and pad bits
-                generate_bits(psdu, data_bits, frame);
-
-                // scrambling
-                scramble(data_bits, scrambled_data, frame, d_scrambler++);
+                // scramble, encode, puncture, interleave and split into symbols,
+                // straight into the output staging buffer
+                encode_data_field(psdu.data,
+                                  d_symbols,
+                                  d_work[0],
+                                  d_work[1],
+                                  psdu.frame,
+                                  d_ofdm,
+                                  d_scrambler++);
                 if (d_scrambler > 127) {
                     d_scrambler = 1;
                 }
 
-                // reset tail bits
-                reset_tail_bits(scrambled_data, frame);
-                // encoding
-                convolutional_encoding(scrambled_data, encoded_data, frame);
-                // puncturing
-                puncturing(encoded_data, punctured_data, frame, d_ofdm);
-                // repeate (only if necessary - MCS 10) and interleave
-                if(d_ofdm.encoding == gr::ieee802_11::BPSK_1_2_REP){
-                    repeat(punctured_data, repeated_data, frame, d_ofdm);
-                    interleave(repeated_data, interleaved_data, frame, d_ofdm);
-                }
-                else{
-                    interleave(punctured_data, interleaved_data, frame, d_ofdm);
-                }
-
-                // one byte per symbol
-                split_symbols(interleaved_data, symbols, frame, d_ofdm);
-
-                d_symbols_len = frame.n_sym * CODED_BITS_PER_OFDM_SYMBOL;
+                d_symbols_len = psdu.frame.n_sym * CODED_BITS_PER_OFDM_SYMBOL;
                 dout << "d_symbols_len = " << d_symbols_len << std::endl;
-                d_symbols = (char*)calloc(d_symbols_len, sizeof(char));
-                std::memcpy(d_symbols, symbols, d_symbols_len);
 
 
                 // add tags
@@ -150,23 +117,22 @@ public:
                 pmt::pmt_t srcid = pmt::string_to_symbol(alias());
                 add_item_tag(0, nitems_written(0), key, value, srcid);
 
-                pmt::pmt_t psdu_bytes = pmt::from_long(psdu_length);
+                pmt::pmt_t psdu_bytes = pmt::from_long(psdu.length);
                 add_item_tag(
                     0, nitems_written(0), pmt::mp("psdu_len"), psdu_bytes, srcid);
 
                 pmt::pmt_t encoding = pmt::from_long(d_ofdm.encoding);
                 add_item_tag(0, nitems_written(0), pmt::mp("encoding"), encoding, srcid);
 
+                add_item_tag(
+                    0, nitems_written(0), pmt::mp("ldpc"), pmt::from_bool(d_ldpc), srcid);
+
+                add_item_tag(0,
+                             nitems_written(0),
+                             pmt::mp("aggregation"),
+                             pmt::from_bool(psdu.aggregation),
+                             srcid);
 
-                free(data_bits);
-                free(scrambled_data);
-                free(encoded_data);
-                free(punctured_data);
-                if(d_ofdm.encoding == gr::ieee802_11::BPSK_1_2_REP){
-                    free(repeated_data);
-                }
-                free(interleaved_data);
-                free(symbols);
 
                 break;
             }
@@ -178,8 +144,6 @@ public:
 
         if (d_symbols_offset == d_symbols_len) {
             d_symbols_offset = 0;
-            free(d_symbols);
-            d_symbols = 0;
         }
 
         return i;
@@ -191,20 +155,36 @@ public:
         std::cout << "MAPPER: encoding: " << encoding << std::endl;
         gr::thread::scoped_lock lock(d_mutex);
 
+        d_encoding = encoding;
         d_ofdm = ofdm_param(encoding);
     }
 
+    void set_ldpc(bool ldpc)
+    {
+
+        std::cout << "MAPPER: coding: " << (ldpc ? "LDPC" : "BCC") << std::endl;
+        gr::thread::scoped_lock lock(d_mutex);
+
+        d_ldpc = ldpc;
+    }
+
 private:
     uint8_t d_scrambler;
     bool d_debug;
-    char* d_symbols;
+    bool d_ldpc;
+    char d_work[2][MAX_CODING_BITS];
+    char d_symbols[MAX_FRAME_SYMBOLS];
+    uint8_t d_psdu[MAX_AMPDU_SIZE]; // A-MPDU with EOF padding
     int d_symbols_offset;
     int d_symbols_len;
+    // encoding of packets without one in their metadata
+    Encoding d_encoding;
+    // encoding of the current packet
     ofdm_param d_ofdm;
     gr::thread::mutex d_mutex;
 };
 
-mapper::sptr mapper::make(Encoding mcs, bool debug)
+mapper::sptr mapper::make(Encoding mcs, bool debug, bool ldpc)
 {
-    return gnuradio::get_initial_sptr(new mapper_impl(mcs, debug));
+    return gnuradio::get_initial_sptr(new mapper_impl(mcs, debug, ldpc));
 }
@@ -0,0 +1,104 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef INCLUDED_IEEE802_11_NUMEROLOGY_H
+#define INCLUDED_IEEE802_11_NUMEROLOGY_H
+
+namespace gr {
+namespace ieee802_11 {
+
+/*
+ * Compile-time description of the S1G OFDM numerology of one channel width.
+ * All widths share the 31.25 kHz subcarrier spacing, so the FFT size grows
+ * with the bandwidth while the symbol duration (32us + GI) stays the same.
+ *
+ * Only the 1 MHz width is defined, the blocks do not run any other yet.
+ *
+ * Subcarriers are addressed either by their logical index k in
+ * [-FFT_SIZE/2, FFT_SIZE/2) or by their position i = k + FFT_SIZE/2 in the
+ * shifted FFT output, which is what the blocks work on.
+ */
+template <int FFT>
+struct numerology;
+
+// 1 MHz, Table 23-4 and Figure 23-3
+template <>
+struct numerology<32> {
+    static constexpr int FFT_SIZE = 32;
+    static constexpr int GI = 8;
+    static constexpr int SHORT_GI = 4;
+    static constexpr int DATA_CARRIERS = 24;
+    static constexpr int PILOTS = 2;
+    static constexpr int STF_SYMBOLS = 4;
+    static constexpr int LTF1_SYMBOLS = 4;
+    static constexpr int SIG_SYMBOLS = 6;
+    static constexpr int SIG_BITS = 36;
+
+    static constexpr bool used(int k) { return k >= -13 && k <= 13 && k != 0; }
+    static constexpr bool pilot(int k) { return k == -7 || k == 7; }
+};
+
+typedef numerology<32> halow_1mhz;
+
+// DC and guard subcarriers, i is the position in the shifted FFT output
+template <class N>
+constexpr bool is_null_subcarrier(int i)
+{
+    return !N::used(i - N::FFT_SIZE / 2);
+}
+
+template <class N>
+constexpr bool is_pilot_subcarrier(int i)
+{
+    return N::pilot(i - N::FFT_SIZE / 2);
+}
+
+template <class N>
+constexpr bool is_data_subcarrier(int i)
+{
+    return !is_null_subcarrier<N>(i) && !is_pilot_subcarrier<N>(i);
+}
+
+// position of the n-th pilot in the shifted FFT output
+template <class N>
+constexpr int pilot_subcarrier(int n)
+{
+    int i = 0;
+    for (; i < N::FFT_SIZE; i++) {
+        if (is_pilot_subcarrier<N>(i) && !n--) {
+            break;
+        }
+    }
+    return i;
+}
+
+template <class N>
+constexpr bool check_numerology()
+{
+    int data = 0;
+    int pilots = 0;
+    for (int i = 0; i < N::FFT_SIZE; i++) {
+        data += is_data_subcarrier<N>(i);
+        pilots += is_pilot_subcarrier<N>(i);
+    }
+    return data == N::DATA_CARRIERS && pilots == N::PILOTS &&
+           N::GI == N::FFT_SIZE / 4 && N::SHORT_GI == N::GI / 2;
+}
+
+static_assert(check_numerology<halow_1mhz>(), "bad 1 MHz numerology");
+
+} // namespace ieee802_11
+} // namespace gr
+
+#endif /* INCLUDED_IEEE802_11_NUMEROLOGY_H */
@@ -0,0 +1,247 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "ofdm_modulator_impl.h"
+#include <gnuradio/io_signature.h>
+
+using namespace gr::ieee802_11;
+
+// repeated frames all get this scrambler seed, so that their samples can be cached
+#define CACHE_SCRAMBLER 1
+
+ofdm_modulator::sptr
+ofdm_modulator::make(
+    Encoding mcs, bool debug, int cache_size, bool short_gi, bool ldpc)
+{
+    return gnuradio::get_initial_sptr(
+        new ofdm_modulator_impl(mcs, debug, cache_size, short_gi, ldpc));
+}
+
+ofdm_modulator_impl::ofdm_modulator_impl(Encoding e,
+                                         bool debug,
+                                         int cache_size,
+                                         bool short_gi,
+                                         bool ldpc)
+    : block("ofdm_modulator",
+            gr::io_signature::make(0, 0, 0),
+            gr::io_signature::make(1, 1, sizeof(gr_complex))),
+      d_debug(debug),
+      d_scrambler(1),
+      d_encoding(e),
+      d_short_gi(short_gi),
+      d_ldpc(ldpc),
+      d_modulator(e),
+      d_cache(cache_size > 0 ? new waveform_cache(cache_size) : nullptr),
+      d_cached_offset(0),
+      d_stage_offset(0),
+      d_stage_len(0)
+{
+    message_port_register_in(pmt::mp("in"));
+    message_port_register_out(pmt::mp("cache"));
+    set_encoding(e);
+}
+
+ofdm_modulator_impl::~ofdm_modulator_impl() {}
+
+void ofdm_modulator_impl::set_encoding(Encoding mcs)
+{
+    std::cout << "OFDM MODULATOR: encoding: " << mcs << std::endl;
+    gr::thread::scoped_lock lock(d_mutex);
+
+    d_encoding = mcs;
+}
+
+void ofdm_modulator_impl::set_short_gi(bool short_gi)
+{
+    std::cout << "OFDM MODULATOR: short GI: " << short_gi << std::endl;
+    gr::thread::scoped_lock lock(d_mutex);
+
+    // cached frames were modulated with the other guard interval
+    if (d_cache && short_gi != d_short_gi) {
+        d_cache->clear();
+    }
+    d_short_gi = short_gi;
+}
+
+void ofdm_modulator_impl::set_ldpc(bool ldpc)
+{
+    std::cout << "OFDM MODULATOR: coding: " << (ldpc ? "LDPC" : "BCC") << std::endl;
+    gr::thread::scoped_lock lock(d_mutex);
+
+    // the cache is keyed by encoding only, not by the code
+    if (d_cache && ldpc != d_ldpc) {
+        d_cache->clear();
+    }
+    d_ldpc = ldpc;
+}
+
+waveform_cache::samples_ptr
+ofdm_modulator_impl::cache_frame(const char* psdu, int psdu_length, uint8_t scrambler)
+{
+    frame_param frame(d_modulator.ofdm(), psdu_length, d_ldpc);
+    d_modulator.start_frame(psdu, psdu_length, frame, scrambler, d_short_gi);
+
+    auto samples = d_modulator.modulate();
+    d_cache->insert(psdu, psdu_length, d_modulator.ofdm().encoding, scrambler, samples);
+    return samples;
+}
+
+int ofdm_modulator_impl::general_work(int noutput,
+                                      gr_vector_int& ninput_items,
+                                      gr_vector_const_void_star& input_items,
+                                      gr_vector_void_star& output_items)
+{
+    gr_complex* out = (gr_complex*)output_items[0];
+
+    while (d_modulator.done() && d_stage_offset == d_stage_len && !d_cached) {
+        pmt::pmt_t msg(delete_head_nowait(pmt::intern("in")));
+
+        if (!msg.get()) {
+            return 0;
+        }
+
+        if (pmt::is_pair(msg)) {
+            dout << "OFDM MODULATOR: received new message" << std::endl;
+            gr::thread::scoped_lock lock(d_mutex);
+
+            // NDP, the frame ends after the SIG field
+            pmt::pmt_t ndp =
+                pmt::is_dict(pmt::car(msg))
+                    ? pmt::dict_ref(pmt::car(msg), pmt::mp("ndp"), pmt::PMT_NIL)
+                    : pmt::PMT_NIL;
+            if (pmt::is_integer(ndp)) {
+                d_modulator.start_ndp(pmt::to_long(ndp));
+
+                pmt::pmt_t srcid = pmt::string_to_symbol(alias());
+                add_item_tag(0,
+                             nitems_written(0),
+                             pmt::mp("packet_len"),
+                             pmt::from_long(frame_modulator::frame_samples(0, false)),
+                             srcid);
+                add_item_tag(0, nitems_written(0), pmt::mp("ndp"), ndp, srcid);
+                break;
+            }
+
+            ofdm_param ofdm = d_modulator.ofdm();
+            tx_psdu tx(ofdm);
+            std::string error = prepare_psdu(msg, d_encoding, d_ldpc, ofdm, d_psdu, tx);
+            if (ofdm.encoding != d_modulator.ofdm().encoding) {
+                d_modulator.set_encoding(ofdm.encoding);
+            }
+            if (!error.empty()) {
+                std::cout << error << ", dropping packet" << std::endl;
+                continue;
+            }
+            const char* psdu = tx.data;
+            int psdu_length = tx.length;
+            frame_param& frame = tx.frame;
+
+            uint8_t scrambler = d_scrambler++;
+            if (d_scrambler > 127) {
+                d_scrambler = 1;
+            }
+
+            // the length of the burst is known up front, so the frame boundary
+            // is marked by a tag and the samples can be streamed out
+            int n_samples = frame_modulator::frame_samples(frame.n_sym, d_short_gi);
+
+            // A-MPDUs are not repeated verbatim, only single MPDUs are cached,
+            // and only once they are sent a second time. Their samples can
+            // only be reused if they always get the same scrambler seed.
+            if (d_cache && !tx.aggregation) {
+                Encoding encoding = d_modulator.ofdm().encoding;
+                if (d_cache->repeated(psdu, psdu_length, encoding)) {
+                    scrambler = CACHE_SCRAMBLER;
+                    d_cached = d_cache->lookup(psdu, psdu_length, encoding, scrambler);
+                    if (!d_cached) {
+                        d_cached = cache_frame(psdu, psdu_length, scrambler);
+                    }
+                    d_cached_offset = 0;
+                }
+
+                pmt::pmt_t stats = pmt::make_dict();
+                stats = pmt::dict_add(
+                    stats, pmt::mp("hits"), pmt::from_uint64(d_cache->hits()));
+                stats = pmt::dict_add(
+                    stats, pmt::mp("misses"), pmt::from_uint64(d_cache->misses()));
+                stats = pmt::dict_add(
+                    stats, pmt::mp("frames"), pmt::from_long(d_cache->size()));
+                stats = pmt::dict_add(
+                    stats, pmt::mp("bytes"), pmt::from_uint64(d_cache->bytes()));
+                message_port_pub(pmt::mp("cache"), stats);
+            }
+            if (!d_cached) {
+                d_modulator.start_frame(
+                    psdu, psdu_length, frame, scrambler, d_short_gi);
+            }
+
+            dout << "OFDM MODULATOR: frame of " << frame.n_sym << " symbols, "
+                 << n_samples << " samples" << std::endl;
+
+            pmt::pmt_t srcid = pmt::string_to_symbol(alias());
+            add_item_tag(0,
+                         nitems_written(0),
+                         pmt::mp("packet_len"),
+                         pmt::from_long(n_samples),
+                         srcid);
+            add_item_tag(0,
+                         nitems_written(0),
+                         pmt::mp("psdu_len"),
+                         pmt::from_long(psdu_length),
+                         srcid);
+            add_item_tag(0,
+                         nitems_written(0),
+                         pmt::mp("encoding"),
+                         pmt::from_long(d_modulator.ofdm().encoding),
+                         srcid);
+            add_item_tag(0,
+                         nitems_written(0),
+                         pmt::mp("aggregation"),
+                         pmt::from_bool(tx.aggregation),
+                         srcid);
+        }
+    }
+
+    int o = 0;
+
+    if (d_cached) {
+        o = std::min(noutput, (int)d_cached->size() - d_cached_offset);
+        std::memcpy(out, d_cached->data() + d_cached_offset, o * sizeof(gr_complex));
+        d_cached_offset += o;
+        if (d_cached_offset == (int)d_cached->size()) {
+            d_cached.reset();
+        }
+        return o;
+    }
+
+    // rest of a symbol that did not fit last time
+    int n = std::min(noutput, d_stage_len - d_stage_offset);
+    std::memcpy(out, d_stage + d_stage_offset, n * sizeof(gr_complex));
+    d_stage_offset += n;
+    o += n;
+
+    while (o < noutput && !d_modulator.done()) {
+        if (noutput - o >= SAMPLES_PER_SYMBOL_WITH_GI + 1) {
+            o += d_modulator.next_symbol(out + o);
+        } else {
+            d_stage_len = d_modulator.next_symbol(d_stage);
+            n = std::min(noutput - o, d_stage_len);
+            std::memcpy(out + o, d_stage, n * sizeof(gr_complex));
+            d_stage_offset = n;
+            o += n;
+        }
+    }
+
+    return o;
+}
@@ -0,0 +1,72 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef INCLUDED_IEEE802_11_OFDM_MODULATOR_IMPL_H
+#define INCLUDED_IEEE802_11_OFDM_MODULATOR_IMPL_H
+
+#include "frame_modulator.h"
+#include "waveform_cache.h"
+#include <ieee802_11/ofdm_modulator.h>
+
+namespace gr {
+namespace ieee802_11 {
+
+class ofdm_modulator_impl : public ofdm_modulator
+{
+public:
+    ofdm_modulator_impl(
+        Encoding e, bool debug, int cache_size, bool short_gi, bool ldpc);
+    ~ofdm_modulator_impl();
+
+    void set_encoding(Encoding mcs);
+    void set_short_gi(bool short_gi);
+    void set_ldpc(bool ldpc);
+
+    int general_work(int noutput_items,
+                     gr_vector_int& ninput_items,
+                     gr_vector_const_void_star& input_items,
+                     gr_vector_void_star& output_items);
+
+private:
+    // modulates the complete frame and adds it to the cache
+    waveform_cache::samples_ptr cache_frame(const char* psdu, int psdu_length, uint8_t scrambler);
+
+    bool d_debug;
+    uint8_t d_scrambler;
+    // encoding of packets without one in their metadata
+    Encoding d_encoding;
+    bool d_short_gi;
+    bool d_ldpc;
+    gr::thread::mutex d_mutex;
+
+    // encoding of the current frame and its symbols
+    frame_modulator d_modulator;
+
+    uint8_t d_psdu[MAX_AMPDU_SIZE]; // A-MPDU with EOF padding
+
+    // frame served from the cache, used instead of the symbol stream
+    std::unique_ptr<waveform_cache> d_cache;
+    waveform_cache::samples_ptr d_cached;
+    int d_cached_offset;
+
+    // staging for a symbol that does not fit into the output buffer
+    gr_complex d_stage[SAMPLES_PER_SYMBOL_WITH_GI + 1];
+    int d_stage_offset;
+    int d_stage_len;
+};
+
+} // namespace ieee802_11
+} // namespace gr
+
+#endif /* INCLUDED_IEEE802_11_OFDM_MODULATOR_IMPL_H */
@@ -67,6 +67,14 @@ public:
 
         dout << std::endl << "new mac frame  (length " << frame_len << ")" << std::endl;
         dout << "=========================================" << std::endl;
+
+        // the protocol version is in the same bits of every frame control
+        if (frame_len >= 2 && (h->frame_control & 3) == PV1_VERSION) {
+            parse_pv1((uint8_t*)h, frame_len);
+            message_port_pub(pmt::mp("out"), pmt::cons(d_meta, d_msg));
+            return;
+        }
+
         if (frame_len < 20) {
             dout << "frame too short to parse (<20)" << std::endl;
             return;
@@ -339,7 +347,70 @@ public:
         d_meta = pmt::dict_add(d_meta, pmt::mp("address 3"), pmt::mp(address));
         dout << "address 3: " << address << std::endl;
 
+        track_seq_no(seq_no);
+    }
+
+    // S1G short MAC header, the addresses are only parsed for QoS data
+    void parse_pv1(uint8_t* buf, int length)
+    {
+        uint16_t frame_control = buf[0] | buf[1] << 8;
+        d_meta = pmt::dict_add(d_meta, pmt::mp("protocol version"), pmt::mp(1));
+        dout << "frame control: " << HEX(frame_control >> 8) << " "
+             << HEX(frame_control & 0xff);
+
+        switch ((frame_control >> 2) & 0x7) {
+        case PV1_TYPE_QOS_DATA:
+            d_meta = pmt::dict_add(d_meta, pmt::mp("type"), pmt::mp("Data"));
+            d_meta = pmt::dict_add(d_meta, pmt::mp("subtype"), pmt::mp("QoS Data"));
+            dout << " (PV1 QOS DATA)" << std::endl;
+            break;
+        case 1:
+            d_meta = pmt::dict_add(d_meta, pmt::mp("type"), pmt::mp("management"));
+            dout << " (PV1 MANAGEMENT)" << std::endl;
+            return;
+        case 2:
+            d_meta = pmt::dict_add(d_meta, pmt::mp("type"), pmt::mp("Control"));
+            dout << " (PV1 CONTROL)" << std::endl;
+            return;
+        default:
+            d_meta = pmt::dict_add(d_meta, pmt::mp("type"), pmt::mp("Reserved"));
+            dout << " (PV1 reserved)" << std::endl;
+            return;
+        }
+
+        pv1_header h;
+        if (!parse_pv1_header(buf, length, h)) {
+            dout << "too short for a data frame" << std::endl;
+            return;
+        }
+
+        int seq_no = int(h.seq_nr >> 4);
+        d_meta = pmt::dict_add(d_meta, pmt::mp("sequence number"), pmt::mp(seq_no));
+        dout << "seq nr: " << seq_no << std::endl;
+
+        d_meta = pmt::dict_add(d_meta, pmt::mp("from ds"), pmt::from_bool(h.from_ds));
+        dout << "from ds: " << h.from_ds << std::endl;
+
+        d_meta = pmt::dict_add(d_meta, pmt::mp("aid"), pmt::mp(h.aid));
+        dout << "aid: " << h.aid << std::endl;
+
+        auto address = format_mac_address((uint8_t*)h.bssid);
+        d_meta = pmt::dict_add(d_meta, pmt::mp("bssid"), pmt::mp(address));
+        dout << "bssid: " << address << std::endl;
+
+        if (h.addr3) {
+            address = format_mac_address((uint8_t*)h.addr3);
+            d_meta = pmt::dict_add(d_meta, pmt::mp("address 3"), pmt::mp(address));
+            dout << "address 3: " << address << std::endl;
+        }
 
+        track_seq_no(seq_no);
+
+        print_ascii((char*)buf + h.size, length - h.size);
+    }
+
+    void track_seq_no(int seq_no)
+    {
         float lost_frames = seq_no - d_last_seq_no - 1;
         if (lost_frames < 0)
             lost_frames += 1 << 12;
@@ -0,0 +1,196 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "ldpc/ldpc.h"
+#include "ldpc/ldpc_decoder.h"
+#include "utils.h"
+
+#include <boost/test/unit_test.hpp>
+#include <random>
+#include <vector>
+
+using namespace gr::ieee802_11;
+
+namespace {
+
+// the 12 codes of Annex F with the number of non-zero blocks of their base
+// matrix, a typo in the tables almost always changes it
+const struct {
+    int n;
+    int rate_num;
+    int rate_den;
+    int rows;
+    int blocks;
+} CODES[] = {
+    { 648, 1, 2, 12, 88 },  { 648, 2, 3, 8, 88 },  { 648, 3, 4, 6, 88 },
+    { 648, 5, 6, 4, 88 },   { 1296, 1, 2, 12, 86 }, { 1296, 2, 3, 8, 88 },
+    { 1296, 3, 4, 6, 88 },  { 1296, 5, 6, 4, 85 },  { 1944, 1, 2, 12, 86 },
+    { 1944, 2, 3, 8, 88 },  { 1944, 3, 4, 6, 85 },  { 1944, 5, 6, 4, 79 },
+};
+
+int shift(const ldpc_code& code, int row, int col)
+{
+    return code.shifts[row * LDPC_BLOCK_COLS + col];
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(test_ldpc_base_matrices)
+{
+    for (const auto& c : CODES) {
+        BOOST_TEST_CONTEXT("code " << c.n << " " << c.rate_num << "/" << c.rate_den)
+        {
+            const ldpc_code* code = ldpc_get_code(c.n, c.rate_num, c.rate_den);
+            BOOST_REQUIRE(code);
+            BOOST_CHECK_EQUAL(code->n, c.n);
+            BOOST_CHECK_EQUAL(code->z, c.n / LDPC_BLOCK_COLS);
+            BOOST_CHECK_EQUAL(code->rows, c.rows);
+            BOOST_CHECK_EQUAL(code->k() * c.rate_den, c.n * c.rate_num);
+
+            int blocks = 0;
+            for (int r = 0; r < code->rows; r++) {
+                for (int b = 0; b < LDPC_BLOCK_COLS; b++) {
+                    BOOST_CHECK(shift(*code, r, b) >= -1 && shift(*code, r, b) < code->z);
+                    blocks += shift(*code, r, b) >= 0;
+                }
+            }
+            BOOST_CHECK_EQUAL(blocks, c.blocks);
+
+            // parity part: the column with shifts 1, 0, 1, then the dual
+            // diagonal of identities
+            int kb = LDPC_BLOCK_COLS - code->rows;
+            for (int r = 0; r < code->rows; r++) {
+                int first = r == 0 || r == code->rows - 1 ? 1 : r == code->rows / 2 ? 0 : -1;
+                BOOST_CHECK_EQUAL(shift(*code, r, kb), first);
+                for (int b = kb + 1; b < LDPC_BLOCK_COLS; b++) {
+                    BOOST_CHECK_EQUAL(shift(*code, r, b),
+                                      b == kb + r || b == kb + r + 1 ? 0 : -1);
+                }
+            }
+        }
+    }
+
+    BOOST_CHECK(!ldpc_get_code(648, 7, 8));
+    BOOST_CHECK(!ldpc_get_code(1000, 1, 2));
+}
+
+BOOST_AUTO_TEST_CASE(test_ldpc_parity_checks)
+{
+    std::mt19937 rng(42);
+    for (const auto& c : CODES) {
+        const ldpc_code& code = *ldpc_get_code(c.n, c.rate_num, c.rate_den);
+        uint8_t cw[LDPC_MAX_N];
+        for (int t = 0; t < 4; t++) {
+            for (int i = 0; i < code.k(); i++) {
+                cw[i] = rng() & 1;
+            }
+            ldpc_encode(code, cw);
+
+            // every row of the expanded parity check matrix
+            int failed = 0;
+            for (int r = 0; r < code.rows; r++) {
+                for (int i = 0; i < code.z; i++) {
+                    int parity = 0;
+                    for (int b = 0; b < LDPC_BLOCK_COLS; b++) {
+                        int s = shift(code, r, b);
+                        if (s >= 0) {
+                            parity ^= cw[b * code.z + (i + s) % code.z];
+                        }
+                    }
+                    failed += parity;
+                }
+            }
+            BOOST_CHECK_MESSAGE(failed == 0,
+                                "code " << c.n << " " << c.rate_num << "/" << c.rate_den
+                                        << ": " << failed << " parity checks fail");
+        }
+    }
+}
+
+namespace {
+
+// PPDU encoding parameters worked out by hand with 19.3.11.7.5 for a 1 MHz
+// S1G DATA field of psdu_size octets (N_pld = 8 * psdu_size + 8)
+const struct {
+    int n_cbps;
+    int n_dbps;
+    int psdu_size;
+    int n;
+    int n_cw;
+    int n_shrt;
+    int n_punc;
+    int n_rep;
+    int n_avbits;
+    int n_sym;
+    bool extra;
+} FRAMES[] = {
+    // MCS0, a single 1944 bit codeword, punctured enough for an extra symbol
+    { 24, 12, 100, 1944, 1, 164, 124, 0, 1656, 69, true },
+    // MCS9, three longest codewords
+    { 192, 160, 511, 1944, 3, 764, 76, 0, 4992, 26, false },
+    // MCS9, a short codeword, repeated to fill the extra symbol
+    { 192, 160, 19, 648, 1, 380, 0, 116, 384, 2, true },
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(test_ldpc_frame_parameters)
+{
+    for (const auto& f : FRAMES) {
+        BOOST_TEST_CONTEXT(f.n_cbps << " coded bits per symbol, " << f.psdu_size
+                                    << " octets")
+        {
+            ldpc_param p(8 * f.psdu_size + 8, f.n_cbps, f.n_dbps);
+            BOOST_REQUIRE(p.code);
+            BOOST_CHECK_EQUAL(p.code->n, f.n);
+            BOOST_CHECK_EQUAL(p.n_cw, f.n_cw);
+            BOOST_CHECK_EQUAL(p.n_shrt, f.n_shrt);
+            BOOST_CHECK_EQUAL(p.n_punc, f.n_punc);
+            BOOST_CHECK_EQUAL(p.n_rep, f.n_rep);
+            BOOST_CHECK_EQUAL(p.n_avbits, f.n_avbits);
+            BOOST_CHECK_EQUAL(p.n_sym, f.n_sym);
+            BOOST_CHECK_EQUAL(p.extra, f.extra);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_ldpc_round_trip)
+{
+    std::mt19937 rng(7);
+    static ldpc_decoder decoder;
+
+    for (const auto& f : FRAMES) {
+        ldpc_param p(8 * f.psdu_size + 8, f.n_cbps, f.n_dbps);
+
+        std::vector<char> in(p.n_pld), out(p.n_avbits);
+        for (char& b : in) {
+            b = rng() & 1;
+        }
+        ldpc_encode_frame(in.data(), out.data(), p);
+
+        // noiseless BPSK, positive means 0
+        std::vector<float> llr(p.n_avbits);
+        for (int i = 0; i < p.n_avbits; i++) {
+            llr[i] = out[i] ? -1.0f : 1.0f;
+        }
+        std::vector<uint8_t> decoded((p.n_pld + 7) / 8);
+        BOOST_CHECK(decoder.decode(llr.data(), decoded.data(), p));
+
+        int errors = 0;
+        for (int i = 0; i < p.n_pld; i++) {
+            errors += GET_PACKED_BIT(decoded.data(), i) != in[i];
+        }
+        BOOST_CHECK_EQUAL(errors, 0);
+    }
+}
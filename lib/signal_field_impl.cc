@@ -29,7 +29,12 @@ signal_field::sptr signal_field::make()
 signal_field::signal_field() : packet_header_default(NUM_BITS_DECODED_SIG_SYMBOL * NUM_OFDM_SYMBOLS_IN_SIG_FIELD * 4, "packet_len"){};
 
 
-signal_field_impl::signal_field_impl() : packet_header_default(NUM_BITS_DECODED_SIG_SYMBOL * NUM_OFDM_SYMBOLS_IN_SIG_FIELD * 4, "packet_len") {}
+signal_field_impl::signal_field_impl() : packet_header_default(NUM_BITS_DECODED_SIG_SYMBOL * NUM_OFDM_SYMBOLS_IN_SIG_FIELD * 4, "packet_len")
+{
+    // build the tables now and not with the first packet
+    sig_table();
+    sig_flips(SIG_FLIP_SHORT_GI);
+}
 
 
 signal_field_impl::~signal_field_impl() {}
@@ -38,36 +43,132 @@ signal_field_impl::~signal_field_impl() {}
 int signal_field_impl::get_bit(int b, int i) { return (b & (1 << i) ? 1 : 0); }
 
 
+/* The SIG field only depends on the MCS and the 9 bit length, so all of its
+ * codewords are generated once and kept bit packed (18 bytes per entry, about
+ * 100kB for MCS0 to MCS10). The rows are indexed by the MCS.
+ */
+const uint8_t* signal_field_impl::sig_table()
+{
+    static const std::vector<uint8_t> table = [] {
+        std::vector<uint8_t> t(NUM_SIG_TABLE_ENCODINGS * (MAX_PSDU_SIZE + 1) *
+                               SIG_TABLE_ENTRY_BYTES);
+        char bits[NUM_CODED_SIG_BITS];
+
+        for (int e = 0; e < NUM_SIG_TABLE_ENCODINGS; e++) {
+            for (int len = 0; len <= MAX_PSDU_SIZE; len++) {
+                encode_signal_field(bits, (Encoding)e, len, false, false, true, false);
+                uint8_t* entry =
+                    &t[(e * (MAX_PSDU_SIZE + 1) + len) * SIG_TABLE_ENTRY_BYTES];
+                for (int i = 0; i < NUM_CODED_SIG_BITS; i++) {
+                    if (bits[i]) {
+                        SET_PACKED_BIT(entry, i);
+                    }
+                }
+            }
+        }
+        return t;
+    }();
+
+    return table.data();
+}
+
+
+/* Encoding, repetition and interleaving are linear and the CRC is affine, so
+ * a header bit toggles the same coded bits whatever the MCS and length are.
+ * The table only holds BCC frames with normal GI, the Short GI, Coding, LDPC
+ * Extra and Aggregation bits are applied as flip masks.
+ */
+const uint8_t* signal_field_impl::sig_flips(sig_flip flip)
+{
+    static const std::vector<uint8_t> flips = [] {
+        // (short GI, LDPC, LDPC extra, aggregation) before and after each flip
+        const bool from[NUM_SIG_FLIPS][4] = { { false, false, true, false },
+                                              { false, false, true, false },
+                                              { false, true, true, false },
+                                              { false, false, true, false } };
+        const bool to[NUM_SIG_FLIPS][4] = { { true, false, true, false },
+                                            { false, true, true, false },
+                                            { false, true, false, false },
+                                            { false, false, true, true } };
+
+        std::vector<uint8_t> f(NUM_SIG_FLIPS * SIG_TABLE_ENTRY_BYTES);
+        for (int m = 0; m < NUM_SIG_FLIPS; m++) {
+            char a[NUM_CODED_SIG_BITS];
+            char b[NUM_CODED_SIG_BITS];
+            encode_signal_field(
+                a, BPSK_1_2, 0, from[m][0], from[m][1], from[m][2], from[m][3]);
+            encode_signal_field(b, BPSK_1_2, 0, to[m][0], to[m][1], to[m][2], to[m][3]);
+            for (int i = 0; i < NUM_CODED_SIG_BITS; i++) {
+                if (a[i] != b[i]) {
+                    SET_PACKED_BIT(&f[m * SIG_TABLE_ENTRY_BYTES], i);
+                }
+            }
+        }
+        return f;
+    }();
+
+    return &flips[flip * SIG_TABLE_ENTRY_BYTES];
+}
+
+
 void signal_field_impl::generate_signal_field(char* out,
                                               frame_param& frame,
-                                              ofdm_param& ofdm)
+                                              ofdm_param& ofdm,
+                                              bool short_gi)
 {
+    // an A-MPDU signals the number of symbols instead of the PSDU length
+    int length = frame.aggregation ? frame.n_sym : frame.psdu_size;
+    if (length < 0 || length > MAX_PSDU_SIZE) {
+        throw std::invalid_argument("PSDU does not fit in the SIG length field");
+    }
 
-    // data bits of the signal header
-    char* signal_header = (char*)malloc(sizeof(char) * NUM_BITS_DECODED_SIG_SYMBOL * NUM_OFDM_SYMBOLS_IN_SIG_FIELD);
+    const uint8_t* entry =
+        sig_table() + (ofdm.encoding * (MAX_PSDU_SIZE + 1) + length) * SIG_TABLE_ENTRY_BYTES;
 
-    // signal header after...
-    // convolutional encoding
-    char* encoded_signal_header = (char*)malloc(sizeof(char) * NUM_BITS_DECODED_SIG_SYMBOL * NUM_OFDM_SYMBOLS_IN_SIG_FIELD * 2);
-    // repeated
-    char* repeated_signal_header = (char*)malloc(sizeof(char) * NUM_BITS_DECODED_SIG_SYMBOL * NUM_OFDM_SYMBOLS_IN_SIG_FIELD * 4);
-    // interleaving
-    char* interleaved_signal_header = (char*)malloc(sizeof(char) * NUM_BITS_DECODED_SIG_SYMBOL * NUM_OFDM_SYMBOLS_IN_SIG_FIELD * 4);
+    for (int i = 0; i < NUM_CODED_SIG_BITS; i++) {
+        out[i] = GET_PACKED_BIT(entry, i);
+    }
+
+    bool flip[NUM_SIG_FLIPS] = { short_gi,
+                                 frame.ldpc,
+                                 frame.ldpc && !frame.ldpc_params.extra,
+                                 frame.aggregation };
+    for (int m = 0; m < NUM_SIG_FLIPS; m++) {
+        if (!flip[m]) {
+            continue;
+        }
+        const uint8_t* flips = sig_flips((sig_flip)m);
+        for (int i = 0; i < NUM_CODED_SIG_BITS; i++) {
+            out[i] ^= GET_PACKED_BIT(flips, i);
+        }
+    }
+}
+
+
+void signal_field_impl::encode_signal_field(char* out,
+                                            Encoding encoding,
+                                            int length,
+                                            bool short_gi,
+                                            bool ldpc,
+                                            bool ldpc_extra,
+                                            bool aggregation)
+{
 
-    int length = frame.psdu_size;
+    // data bits of the signal header
+    char signal_header[NUM_BITS_IN_HALOW_SIG_FIELD];
 
     // B0-B1 NSTS
     signal_header[0] = 0;//1 spatial stream
     signal_header[1] = 0;
 
     // B2 Short GI
-    signal_header[2] = 0;//short GI
+    signal_header[2] = short_gi;//short GI
 
     // B3 Coding
-    signal_header[3] = 0;//BCC
+    signal_header[3] = ldpc;//0 BCC, 1 LDPC
 
     // B4 LDPC Extra
-    signal_header[4] = 1;//If Coding field is 0, this field is set to 1.
+    signal_header[4] = ldpc ? ldpc_extra : 1;//If Coding field is 0, this field is set to 1.
 
     // B5 STBC 
     signal_header[5] = 0;//1 spatial stream so no space time block coding
@@ -76,13 +177,13 @@ void signal_field_impl::generate_signal_field(char* out,
     signal_header[6] = 1;//Reserved
 
     // B7-B10 MCS
-    signal_header[7] = get_bit(ofdm.encoding, 0);//MCS LSB first, MSB last
-    signal_header[8] = get_bit(ofdm.encoding, 1);
-    signal_header[9] = get_bit(ofdm.encoding, 2);
-    signal_header[10] = get_bit(ofdm.encoding, 3);
+    signal_header[7] = get_bit(encoding, 0);//MCS LSB first, MSB last
+    signal_header[8] = get_bit(encoding, 1);
+    signal_header[9] = get_bit(encoding, 2);
+    signal_header[10] = get_bit(encoding, 3);
 
     // B11 Aggregation
-    signal_header[11] = 0;//length field represents number of bytes in ofdm frame
+    signal_header[11] = aggregation;//1: length field represents number of symbols instead of bytes
 
     // B12-B20 Length
     signal_header[12] = get_bit(length, 0);
@@ -106,7 +207,19 @@ void signal_field_impl::generate_signal_field(char* out,
     signal_header[24] = 0;//no travelling pilots for the moment
 
     // B25 NDP Indication
-    signal_header[25] = 0;//no ndp for the moment
+    signal_header[25] = 0;
+
+    encode_signal_header(signal_header, out);
+}
+
+
+void signal_field_impl::encode_signal_header(char* signal_header, char* out)
+{
+    // signal header after...
+    // convolutional encoding
+    char encoded_signal_header[NUM_BITS_IN_HALOW_SIG_FIELD * 2];
+    // repeated
+    char repeated_signal_header[NUM_CODED_SIG_BITS];
 
     // B26-B29 CRC
     uint8_t crc = compute_crc((uint8_t *) signal_header);
@@ -135,12 +248,24 @@ void signal_field_impl::generate_signal_field(char* out,
     // interleaving
     interleave(repeated_signal_header, out, signal_param, signal_ofdm);
     //TODO add p_n multiplyer here
+}
+
+void signal_field_impl::generate_ndp_signal_field(char* out, uint32_t body)
+{
+    char signal_header[NUM_BITS_IN_HALOW_SIG_FIELD];
+
+    // B0-B24 NDP CMAC frame body
+    for (int i = 0; i < NDP_BODY_BITS; i++) {
+        signal_header[i] = get_bit(body, i);
+    }
 
-    free(signal_header);
-    free(encoded_signal_header);
-    free(interleaved_signal_header);
+    // B25 NDP Indication
+    signal_header[25] = 1;
+
+    encode_signal_header(signal_header, out);
 }
 
+
 bool signal_field_impl::header_formatter(long packet_len,
                                          unsigned char* out,
                                          const std::vector<tag_t>& tags)
@@ -148,6 +273,8 @@ bool signal_field_impl::header_formatter(long packet_len,
 
     bool encoding_found = false;
     bool len_found = false;
+    bool ldpc = false;
+    bool aggregation = false;
     int encoding = 0;
     int len = 0;
 
@@ -159,6 +286,10 @@ bool signal_field_impl::header_formatter(long packet_len,
         } else if (pmt::eq(tags[i].key, pmt::mp("psdu_len"))) {
             len_found = true;
             len = pmt::to_long(tags[i].value);
+        } else if (pmt::eq(tags[i].key, pmt::mp("ldpc"))) {
+            ldpc = pmt::to_bool(tags[i].value);
+        } else if (pmt::eq(tags[i].key, pmt::mp("aggregation"))) {
+            aggregation = pmt::to_bool(tags[i].value);
         }
     }
 
@@ -168,7 +299,7 @@ bool signal_field_impl::header_formatter(long packet_len,
     }
 
     ofdm_param ofdm((Encoding)encoding);
-    frame_param frame(ofdm, len);
+    frame_param frame(ofdm, len, ldpc, aggregation);
 
     generate_signal_field((char*)out, frame, ofdm);
     return true;
@@ -24,6 +24,20 @@
 namespace gr {
 namespace ieee802_11 {
 
+#define NUM_CODED_SIG_BITS (NUM_BITS_DECODED_SIG_SYMBOL * NUM_OFDM_SYMBOLS_IN_SIG_FIELD * 4)
+#define SIG_TABLE_ENTRY_BYTES ((NUM_CODED_SIG_BITS + 7) / 8)
+// MCS0 to MCS10, MCS10 is BPSK_1_2_REP
+#define NUM_SIG_TABLE_ENCODINGS 11
+
+// rows of the flip masks
+enum sig_flip {
+    SIG_FLIP_SHORT_GI,
+    SIG_FLIP_LDPC,
+    SIG_FLIP_NO_LDPC_EXTRA,
+    SIG_FLIP_AGGREGATION,
+    NUM_SIG_FLIPS
+};
+
 class signal_field_impl : public signal_field
 {
 public:
@@ -35,9 +49,33 @@ public:
 
     bool header_parser(const unsigned char* header, std::vector<tag_t>& tags);
 
+    // writes the 144 coded, repeated and interleaved bits of the SIG field,
+    // the coding and aggregation come from the frame
+    void generate_signal_field(char* out,
+                               frame_param& frame,
+                               ofdm_param& ofdm,
+                               bool short_gi = false);
+
+    // same for the SIG field of an NDP, body holds B0-B24
+    void generate_ndp_signal_field(char* out, uint32_t body);
+
 private:
-    int get_bit(int b, int i);
-    void generate_signal_field(char* out, frame_param& frame, ofdm_param& ofdm);
+    static int get_bit(int b, int i);
+    // runs the complete SIG encoding chain, only used to fill the table
+    static void encode_signal_field(char* out,
+                                    Encoding encoding,
+                                    int length,
+                                    bool short_gi,
+                                    bool ldpc,
+                                    bool ldpc_extra,
+                                    bool aggregation);
+    // adds CRC and tail to B0-B25 and codes, repeats and interleaves them
+    static void encode_signal_header(char* signal_header, char* out);
+    // packed SIG codewords of all encodings and lengths
+    static const uint8_t* sig_table();
+    // coded bits that flip with short GI, LDPC, no LDPC extra symbol and
+    // aggregation
+    static const uint8_t* sig_flips(sig_flip flip);
 };
 
 } // namespace ieee802_11
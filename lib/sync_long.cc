@@ -21,6 +21,7 @@
 #include <ieee802_11/sync_long.h>
 #include <volk/volk.h>
 
+#include <deque>
 #include <list>
 #include <tuple>
 
@@ -34,25 +35,38 @@ bool compare_abs(const std::pair<gr_complex, int>& first,
     return abs(get<0>(first)) > abs(get<0>(second));
 }
 
+// the first DATA symbol keeps the normal GI
+#define SHORT_GI_START (DATA_FIELD_START + SAMPLES_PER_OFDM_SYMBOL + SAMPLES_PER_GI)
+
 class sync_long_impl : public sync_long
 {
 
 public:
-    sync_long_impl(unsigned int sync_length, bool log, bool debug)
+    sync_long_impl(unsigned int sync_length, bool log, bool debug, bool short_gi)
         : block("sync_long",
                 gr::io_signature::make2(2, 2, sizeof(gr_complex), sizeof(gr_complex)),
                 gr::io_signature::make(1, 1, sizeof(gr_complex))),
+          d_state(SYNC),
+          d_offset(0),
+          d_rx_time(pmt::PMT_NIL),
           d_fir(gr::filter::kernel::fir_filter_ccc(LONG)),
           d_log(log),
           d_debug(debug),
-          d_offset(0),
-          d_state(SYNC),
-          SYNC_LENGTH(sync_length)//sync_len is the number of samples from the preambule start (1st STS complex symbol) to the end of the second LTS (last complex symbol of the second LTS).
+          SYNC_LENGTH(sync_length),//sync_len is the number of samples from the preambule start (1st STS complex symbol) to the end of the second LTS (last complex symbol of the second LTS).
                                     //in a first instance, we want to avoid changing the algorithm for peak detection. Therefore we need to make sure only 2 LTS are contained in the 
                                     //sync_length. This means sync_length should be 240 (- min_plateau) samples long.
+          d_short_gi(short_gi),
+          d_frame_id(0),
+          d_gi_known(false),
+          d_frame_short_gi(false)
     {
 
         set_tag_propagation_policy(block::TPP_DONT);
+
+        message_port_register_in(pmt::mp("gi"));
+        set_msg_handler(pmt::mp("gi"),
+                        boost::bind(&sync_long_impl::gi_in, this, boost::placeholders::_1));
+
         d_correlation = (gr_complex*)volk_malloc(sizeof(gr_complex) * 8192, volk_get_alignment());
     }
 
@@ -76,7 +90,7 @@ public:
         int ninput = std::min(std::min(ninput_items[0], ninput_items[1]), 8192);
 
         const uint64_t nread = nitems_read(0);
-        get_tags_in_range(d_tags, 0, nread, nread + ninput);
+        get_tags_in_range(d_tags, 0, nread, nread + ninput, pmt::mp("wifi_start"));
         if (d_tags.size()) {
             std::sort(d_tags.begin(), d_tags.end(), gr::tag_t::offset_compare);
 
@@ -92,6 +106,10 @@ public:
                     d_state = RESET;
                 }
                 d_freq_offset_short = pmt::to_double(d_tags.front().value);
+
+                std::vector<gr::tag_t> time;
+                get_tags_in_range(time, 0, nread, nread + 1, pmt::mp("rx time"));
+                d_rx_time = time.size() ? time.front().value : pmt::PMT_NIL;
             }
         }
 
@@ -118,6 +136,8 @@ public:
                     d_offset = 0;
                     d_count = 0;
                     d_state = COPY;
+                    d_gi_known = false;
+                    d_frame_short_gi = false;
 
                     break;
                 }
@@ -136,10 +156,27 @@ public:
                                  pmt::string_to_symbol("wifi_start"),
                                  pmt::from_double(d_freq_offset_short - d_freq_offset),
                                  pmt::string_to_symbol(name()));
+                    // d_frame_start is counted from the sample sync short tagged
+                    if (pmt::is_tuple(d_rx_time)) {
+                        add_item_tag(0,
+                                     nitems_written(0),
+                                     pmt::mp("rx time"),
+                                     timestamp_add(d_rx_time, d_frame_start),
+                                     pmt::string_to_symbol(name()));
+                    }
+                    // the equalizer sees the frame start at this OFDM symbol
+                    d_frame_id = nitems_written(0) / SAMPLES_PER_OFDM_SYMBOL;
+                }
+
+                // hold the DATA field back until the equalizer has decoded
+                // SIG and told us which GI it uses
+                if (rel == DATA_FIELD_START && d_short_gi && !d_gi_known &&
+                    !check_gi()) {
+                    break;
                 }
 
                 // send LTFs + SIG + DATA downstream with GIs filtered out
-                if (rel >= 0 && (rel < 2*SAMPLES_PER_OFDM_SYMBOL || ((rel - 2*SAMPLES_PER_OFDM_SYMBOL) % (SAMPLES_PER_OFDM_SYMBOL + SAMPLES_PER_GI)) > (SAMPLES_PER_GI - 1))) {
+                if (keep_sample(rel)) {
                     //we mulitply by +d_freq_offset because we take conj of the second peak for freq offset computation (and not conj of first one)
                     out[o] = in_delayed[i] * exp(gr_complex(0, d_freq_offset * d_offset));
                     o++;
@@ -190,6 +227,52 @@ public:
         }
     }
 
+    bool keep_sample(int rel)
+    {
+        if (rel < 0) {
+            return false;
+        }
+        if (rel < 2 * SAMPLES_PER_OFDM_SYMBOL) {
+            return true;
+        }
+        if (d_frame_short_gi && rel >= SHORT_GI_START) {
+            return ((rel - SHORT_GI_START) %
+                    (SAMPLES_PER_OFDM_SYMBOL + SAMPLES_PER_SHORT_GI)) >=
+                   SAMPLES_PER_SHORT_GI;
+        }
+        return ((rel - 2 * SAMPLES_PER_OFDM_SYMBOL) %
+                (SAMPLES_PER_OFDM_SYMBOL + SAMPLES_PER_GI)) >= SAMPLES_PER_GI;
+    }
+
+    // (frame id, short GI) of every SIG field the equalizer decoded
+    void gi_in(pmt::pmt_t msg)
+    {
+        d_gi.push_back(std::make_pair(pmt::to_uint64(pmt::car(msg)),
+                                      pmt::to_bool(pmt::cdr(msg))));
+    }
+
+    bool check_gi()
+    {
+        // answers for frames we already gave up on
+        while (d_gi.size() && d_gi.front().first < d_frame_id) {
+            d_gi.pop_front();
+        }
+
+        if (d_gi.empty()) {
+            return false;
+        }
+
+        if (d_gi.front().first == d_frame_id) {
+            d_frame_short_gi = d_gi.front().second;
+            d_gi.pop_front();
+        }
+        d_gi_known = true;
+
+        dout << "LONG: frame " << d_frame_id << " short GI " << d_frame_short_gi
+             << std::endl;
+        return true;
+    }
+
     void search_frame_start()
     {
 
@@ -240,6 +323,8 @@ private:
     int d_frame_start;
     float d_freq_offset;
     double d_freq_offset_short;
+    // timestamp of the sample sync short tagged
+    pmt::pmt_t d_rx_time;
 
     gr_complex* d_correlation;
     list<pair<gr_complex, int>> d_cor;
@@ -250,12 +335,20 @@ private:
     const bool d_debug;
     const int SYNC_LENGTH;
 
+    const bool d_short_gi;
+    uint64_t d_frame_id;
+    bool d_gi_known;
+    bool d_frame_short_gi;
+    std::deque<std::pair<uint64_t, bool>> d_gi;
+
     static const std::vector<gr_complex> LONG;
 };
 
-sync_long::sptr sync_long::make(unsigned int sync_length, bool log, bool debug)
+sync_long::sptr
+sync_long::make(unsigned int sync_length, bool log, bool debug, bool short_gi)
 {
-    return gnuradio::get_initial_sptr(new sync_long_impl(sync_length, log, debug));
+    return gnuradio::get_initial_sptr(
+        new sync_long_impl(sync_length, log, debug, short_gi));
 }
 
 // from root of project directory:
@@ -18,6 +18,8 @@
 #include <gnuradio/io_signature.h>
 #include <ieee802_11/sync_short.h>
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
 using namespace gr::ieee802_11;
@@ -25,11 +27,18 @@ using namespace gr::ieee802_11;
 static const int MIN_GAP = 16 * (SAMPLES_PER_OFDM_SYMBOL + SAMPLES_PER_GI); // MIN_GAP is basically the minimum number of samples to be outputted. Basically, it corresponds to the minimum number of samples per Halow frame. If a similar approach is taken as from 802.11a, it should be equal to 16*(SAMPLES_PER_OFDM_SYMBOL + SAMPLES_PER_GI) = 640 (4 symbols STF + 4 symbols LTF1 + 6 symbols SIG + 1 symbol LTF2 + 1 symbol DATA = 16 symbols)
 static const int MAX_SAMPLES = (MAX_PSDU_SIZE * 8 / 6 + 14) * (SAMPLES_PER_OFDM_SYMBOL + SAMPLES_PER_GI); // MAX_SAMPLES is the maximum number of samples to be outputted and corresponds to the maximum number of samples per Halow frames. If you consider the max length to be 511 bytes (length field in SIG is coded on 9 bits, see Table 23-18), the corresponding number of data symbols in BPSK 1/2 x2 equals 511*8/6 (~682). If you add this up to 4 symbols STF, 4 symbols LTF1, 6 symbols SIG, you come out with MAX_SAMPLES = 696*(SAMPLES_PER_OFDM_SYMBOL + SAMPLES_PER_GI)
 
+// the power for energy detection is averaged over about CCA_WINDOW samples
+#define CCA_WINDOW 16
+
 class sync_short_impl : public sync_short
 {
 
 public:
-    sync_short_impl(double threshold, unsigned int min_plateau, bool log, bool debug)
+    sync_short_impl(double threshold,
+                    unsigned int min_plateau,
+                    bool log,
+                    bool debug,
+                    double cca_threshold)
         : block("sync_short",
                 gr::io_signature::make3(
                     3, 3, sizeof(gr_complex), sizeof(gr_complex), sizeof(float)),
@@ -41,8 +50,16 @@ public:
           d_freq_offset(0),
           d_copied(0),
           MIN_PLATEAU(min_plateau),
-          d_threshold(threshold)
+          d_threshold(threshold),
+          d_rx_time(make_timestamp(0, 0)),
+          d_rx_time_item(0),
+          d_cca_threshold(std::pow(10, cca_threshold / 10)),
+          d_power(0),
+          d_cca_busy(false),
+          d_preamble_start(0),
+          d_preamble_end(0)
     {
+        message_port_register_out(pmt::mp("cca"));
 
         set_tag_propagation_policy(block::TPP_DONT);
     }
@@ -62,6 +79,15 @@ public:
         int ninput =
             std::min(std::min(ninput_items[0], ninput_items[1]), ninput_items[2]);
 
+        // the latest rx_time of the radio anchors the timestamps of the frames
+        get_tags_in_range(
+            d_tags, 0, nitems_read(0), nitems_read(0) + ninput, pmt::mp("rx_time"));
+        if (d_tags.size()) {
+            std::sort(d_tags.begin(), d_tags.end(), gr::tag_t::offset_compare);
+            d_rx_time = d_tags.back().value;
+            d_rx_time_item = d_tags.back().offset;
+        }
+
         // dout << "SHORT noutput : " << noutput << " ninput: " << ninput_items[0] <<
         // std::endl;
 
@@ -81,6 +107,7 @@ public:
                         d_freq_offset = arg(in_abs[i]) / SAMPLES_PER_GI;
                         d_plateau = 0;
                         insert_tag(nitems_written(0), d_freq_offset, nitems_read(0) + i);
+                        preamble(nitems_read(0) + i);
                         dout << "SHORT Frame!" << std::endl;
                         break;
                     }
@@ -89,6 +116,7 @@ public:
                 }
             }
 
+            cca(in, i);
             consume_each(i);
             return 0;
         }
@@ -108,6 +136,7 @@ public:
                         d_freq_offset = arg(in_abs[o]) / SAMPLES_PER_GI;
                         insert_tag(
                             nitems_written(0) + o, d_freq_offset, nitems_read(0) + o);
+                        preamble(nitems_read(0) + o);
                         dout << "SHORT Frame!" << std::endl;
                         break;
                     }
@@ -127,6 +156,7 @@ public:
 
             dout << "SHORT copied " << o << std::endl;
 
+            cca(in, o);
             consume_each(o);
             return o;
         }
@@ -144,6 +174,44 @@ public:
         const pmt::pmt_t value = pmt::from_double(freq_offset);
         const pmt::pmt_t srcid = pmt::string_to_symbol(name());
         add_item_tag(0, item, key, value, srcid);
+
+        // sample clock time of the input item, sync long refines it to the LTF
+        add_item_tag(0,
+                     item,
+                     pmt::mp("rx time"),
+                     timestamp_add(d_rx_time, input_item - d_rx_time_item),
+                     srcid);
+    }
+
+    // the medium is busy for the shortest PPDU after a detected preamble,
+    // even if the frame is too weak for energy detection
+    void preamble(uint64_t item)
+    {
+        d_preamble_start = item;
+        d_preamble_end = item + MIN_GAP;
+    }
+
+    // clear channel assessment of the n samples about to be consumed
+    void cca(const gr_complex* in, int n)
+    {
+        for (int i = 0; i < n; i++) {
+            uint64_t item = nitems_read(0) + i;
+            d_power += (std::norm(in[i]) - d_power) / CCA_WINDOW;
+            bool busy = d_power > d_cca_threshold ||
+                        (item >= d_preamble_start && item < d_preamble_end);
+            if (busy == d_cca_busy) {
+                continue;
+            }
+
+            d_cca_busy = busy;
+            dout << "SHORT CCA " << (busy ? "busy" : "idle") << " at " << item
+                 << std::endl;
+
+            pmt::pmt_t dict = pmt::make_dict();
+            dict = pmt::dict_add(dict, pmt::mp("busy"), pmt::from_bool(busy));
+            dict = pmt::dict_add(dict, pmt::mp("sample"), pmt::from_uint64(item));
+            message_port_pub(pmt::mp("cca"), dict);
+        }
     }
 
 private:
@@ -155,11 +223,24 @@ private:
     const bool d_log;
     const bool d_debug;
     const unsigned int MIN_PLATEAU;
+
+    std::vector<gr::tag_t> d_tags;
+    // timestamp of input item d_rx_time_item
+    pmt::pmt_t d_rx_time;
+    uint64_t d_rx_time_item;
+
+    // clear channel assessment, the threshold is a linear power
+    const double d_cca_threshold;
+    double d_power;
+    bool d_cca_busy;
+    // input items that are busy because of the last detected preamble
+    uint64_t d_preamble_start;
+    uint64_t d_preamble_end;
 };
 
-sync_short::sptr
-sync_short::make(double threshold, unsigned int min_plateau, bool log, bool debug)
+sync_short::sptr sync_short::make(
+    double threshold, unsigned int min_plateau, bool log, bool debug, double cca_threshold)
 {
     return gnuradio::get_initial_sptr(
-        new sync_short_impl(threshold, min_plateau, log, debug));
+        new sync_short_impl(threshold, min_plateau, log, debug, cca_threshold));
 }
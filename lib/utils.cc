@@ -17,8 +17,12 @@
 #include "utils.h"
 
 #include <math.h>
+#include <boost/crc.hpp>
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstring>
+#include <stdexcept>
 
 using gr::ieee802_11::BPSK_1_2;
 using gr::ieee802_11::QPSK_1_2;
@@ -28,7 +32,69 @@ using gr::ieee802_11::QAM16_3_4;
 using gr::ieee802_11::QAM64_2_3;
 using gr::ieee802_11::QAM64_3_4;
 using gr::ieee802_11::QAM64_5_6;
+using gr::ieee802_11::QAM256_3_4;
+using gr::ieee802_11::QAM256_5_6;
 using gr::ieee802_11::BPSK_1_2_REP;
+using gr::ieee802_11::ldpc_param;
+using gr::ieee802_11::ldpc_encode_frame;
+using gr::ieee802_11::ldpc_tone;
+
+bool parse_pv1_header(const uint8_t* mpdu, int len, pv1_header& header)
+{
+    if (len < PV1_DATA_HEADER_SIZE) {
+        return false;
+    }
+
+    header.frame_control = mpdu[0] | mpdu[1] << 8;
+    if ((header.frame_control & 0x3) != PV1_VERSION ||
+        ((header.frame_control >> 2) & 0x7) != PV1_TYPE_QOS_DATA) {
+        return false;
+    }
+    header.from_ds = header.frame_control & PV1_FROM_DS;
+
+    const uint8_t* sid = mpdu + (header.from_ds ? 2 : 8);
+    uint16_t sid_field = sid[0] | sid[1] << 8;
+    header.aid = sid_field & PV1_AID_MASK;
+    header.bssid = mpdu + (header.from_ds ? 4 : 2);
+    header.seq_nr = mpdu[10] | mpdu[11] << 8;
+    header.size = PV1_DATA_HEADER_SIZE;
+
+    header.addr3 = nullptr;
+    if (sid_field & PV1_A3_PRESENT) {
+        header.addr3 = mpdu + header.size;
+        header.size += 6;
+    }
+    if (sid_field & PV1_A4_PRESENT) {
+        header.size += 6;
+    }
+
+    return len >= header.size;
+}
+
+int write_pv1_header(uint8_t* out,
+                     int tid,
+                     bool from_ds,
+                     int aid,
+                     const uint8_t* bssid,
+                     uint16_t seq_nr,
+                     bool more_frags)
+{
+    uint16_t frame_control = PV1_VERSION | PV1_TYPE_QOS_DATA << 2 | (tid & 0x7) << 5 |
+                             (from_ds ? PV1_FROM_DS : 0) |
+                             (more_frags ? PV1_MORE_FRAGMENTS : 0);
+    out[0] = frame_control & 0xff;
+    out[1] = frame_control >> 8;
+
+    uint8_t* sid = out + (from_ds ? 2 : 8);
+    sid[0] = aid & 0xff;
+    sid[1] = (aid >> 8) & (PV1_AID_MASK >> 8);
+    std::memcpy(out + (from_ds ? 4 : 2), bssid, 6);
+
+    out[10] = seq_nr & 0xff;
+    out[11] = seq_nr >> 8;
+
+    return PV1_DATA_HEADER_SIZE;
+}
 
 ofdm_param::ofdm_param(Encoding e)
 {
@@ -80,7 +146,7 @@ ofdm_param::ofdm_param(Encoding e)
         n_cbps = 144;
         n_dbps = 96;
         //rate_field = 0x01; // 0b00000001
-        constellation =  gr::ieee802_11::constellation_16qam::make();
+        constellation =  gr::ieee802_11::constellation_64qam::make();
         break;
 
     case QAM64_3_4:
@@ -98,6 +164,20 @@ ofdm_param::ofdm_param(Encoding e)
         //rate_field = 0x03; // 0b00000011
         constellation =  gr::ieee802_11::constellation_64qam::make();
         break;
+
+    case QAM256_3_4:
+        n_bpsc = 8;
+        n_cbps = 192;
+        n_dbps = 144;
+        constellation =  gr::ieee802_11::constellation_256qam::make();
+        break;
+
+    case QAM256_5_6:
+        n_bpsc = 8;
+        n_cbps = 192;
+        n_dbps = 160;
+        constellation =  gr::ieee802_11::constellation_256qam::make();
+        break;
     
     case BPSK_1_2_REP:
         n_bpsc = 1;
@@ -125,11 +205,31 @@ void ofdm_param::print()
 }
 
 //constructor to be used for data frames
-frame_param::frame_param(ofdm_param& ofdm, int psdu_length)
+frame_param::frame_param(ofdm_param& ofdm, int psdu_length, bool ldpc, bool aggregation)
+    : ldpc(ldpc), aggregation(aggregation)
 {
 
     psdu_size = psdu_length;
 
+    if (ldpc) {
+        if (ofdm.encoding == BPSK_1_2_REP) {
+            throw std::invalid_argument("MCS10 does not support LDPC");
+        }
+
+        // no tail bits, the PSDU is not padded to whole symbols unless it is
+        // an A-MPDU, where the receiver only knows the number of symbols
+        int n_pld = 8 * psdu_size + 8;
+        if (aggregation) {
+            n_pld = (n_pld + ofdm.n_dbps - 1) / ofdm.n_dbps * ofdm.n_dbps;
+        }
+        ldpc_params = ldpc_param(n_pld, ofdm.n_cbps, ofdm.n_dbps);
+        n_sym = ldpc_params.n_sym;
+        n_data_bits = ldpc_params.n_pld;
+        n_pad = 0;
+        n_encoded_bits = ldpc_params.n_avbits;
+        return;
+    }
+
     // number of symbols p.3248 "Data Field" for HaLow OR EQN23-65 on p.3302 OR EQN 23-66 on p.3303
     n_sym = (int)ceil((8 * psdu_size + 8 + 6) / (double) ofdm.n_dbps);//see Equation 23-79
 
@@ -142,16 +242,26 @@ frame_param::frame_param(ofdm_param& ofdm, int psdu_length)
 }
 
 //constructor to be used for SIG field
-frame_param::frame_param(ofdm_param& ofdm){
+frame_param::frame_param(ofdm_param& ofdm) : ldpc(false), aggregation(false)
+{
     //sig field is always NUM_OFDM_SYMBOLS_IN_SIG_FIELD symbols long
     n_sym = NUM_OFDM_SYMBOLS_IN_SIG_FIELD;
-    //viterbi decoder processes bytes per bytes. n_encoded_bits needs to be the nearest mulitple of 8 capable of holding the number of encoded bits in the sig field
-    n_encoded_bits = (n_sym * ofdm.n_cbps) + (8 - (n_sym * ofdm.n_cbps) % 8);
+    n_encoded_bits = n_sym * ofdm.n_cbps;
     //sig field is bpsk 1/2 coded
     n_data_bits = n_encoded_bits/2;
 
 }
 
+int ampdu_psdu_length(ofdm_param& ofdm, int n_sym, bool ldpc, bool ldpc_extra)
+{
+    int bits = n_sym * ofdm.n_dbps - 8 - 6;
+    if (ldpc) {
+        // no tail bits, and the LDPC extra symbol carries no payload
+        bits = (n_sym - ldpc_extra) * ofdm.n_dbps - 8;
+    }
+    return std::max(0, bits / 8);
+}
+
 void frame_param::print()
 {
     std::cout << "FRAME Parameters:" << std::endl;
@@ -235,13 +345,24 @@ void puncturing(const char* in, char* out, frame_param& frame, ofdm_param& ofdm)
         case QPSK_3_4:
         case QAM16_3_4:
         case QAM64_3_4:
+        case QAM256_3_4:
             mod = i % 6;
             if (!(mod == 3 || mod == 4)) {
                 *out = in[i];
                 out++;
             }
             break;
-        //TODO : Add QAM64_5_6
+
+        case QAM64_5_6:
+        case QAM256_5_6:
+            // A1 B1 A2 B3 A4 B5 of every five input bits
+            mod = i % 10;
+            if (!(mod == 3 || mod == 4 || mod == 7 || mod == 8)) {
+                *out = in[i];
+                out++;
+            }
+            break;
+
         defaut:
             assert(false);
             break;
@@ -353,6 +474,48 @@ void generate_bits(const char* psdu, char* data_bits, frame_param& frame)
             data_bits[i * 8 + b] = !!(psdu[i] & (1 << b));
         }
     }
+
+    // tail and pad bits, the buffer may be reused between frames
+    memset(data_bits + frame.psdu_size * 8, 0, frame.n_data_bits - 8 - frame.psdu_size * 8);
+}
+
+void encode_data_field(const char* psdu,
+                       char* symbols,
+                       char* work0,
+                       char* work1,
+                       frame_param& frame,
+                       ofdm_param& ofdm,
+                       char scrambler)
+{
+    // the coding steps ping-pong between the two work buffers
+    generate_bits(psdu, work0, frame);
+    scramble(work0, work1, frame, scrambler);
+
+    if (frame.ldpc) {
+        ldpc_encode_frame(work1, work0, frame.ldpc_params);
+        split_symbols(work0, work1, frame, ofdm);
+        for (int s = 0; s < frame.n_sym; s++) {
+            for (int k = 0; k < CODED_BITS_PER_OFDM_SYMBOL; k++) {
+                symbols[s * CODED_BITS_PER_OFDM_SYMBOL + ldpc_tone(k)] =
+                    work1[s * CODED_BITS_PER_OFDM_SYMBOL + k];
+            }
+        }
+        return;
+    }
+
+    reset_tail_bits(work1, frame);
+    convolutional_encoding(work1, work0, frame);
+    puncturing(work0, work1, frame, ofdm);
+
+    // repeat (only MCS10) and interleave
+    if (ofdm.encoding == BPSK_1_2_REP) {
+        repeat(work1, work0, frame, ofdm);
+        interleave(work0, work1, frame, ofdm);
+        split_symbols(work1, symbols, frame, ofdm);
+    } else {
+        interleave(work1, work0, frame, ofdm);
+        split_symbols(work0, symbols, frame, ofdm);
+    }
 }
 
 
@@ -386,64 +549,189 @@ void unrepeat(gr_complex* unrepeated, gr_complex* deinterleaved){
     }
 }
 
-// Compute the crc-4bit, a byte at a time using the table approach
-// This code was partially generated from the crcany program of Mark Adler (see https://github.com/madler/crcany)
-uint8_t crc4HaLoW_byte(uint8_t crc, void const *mem, size_t len) {
-    unsigned char const *data = static_cast<unsigned char const *>(mem);
-    if (data == nullptr)
-        return 0;
-    crc <<= 4;
-    for (size_t i = 0; i < len; i++) {
-        crc = table_byte[crc ^ data[i]];
+// Compute the crc-4bit over the first 26 bits of the SIG field, one bit at a time.
+// Generator x^4 + x + 1, register preset to ones (same as inverting the first
+// four bits) and the remainder is inverted, as for the HT-SIG CRC.
+uint8_t compute_crc(const uint8_t* decoded_bits){
+
+    uint8_t crc = 0xf;
+    for (int i = 0; i < 26; i++) {
+        uint8_t feedback = ((crc >> 3) ^ decoded_bits[i]) & 1;
+        crc = (crc << 1) & 0xf;
+        if (feedback) {
+            crc ^= 0x3;
+        }
     }
-    crc >>= 4;
 
     return crc ^ 0xf;
 }
 
-uint8_t compute_crc(uint8_t* decoded_bits){
+// Generator x^8 + x^2 + x + 1, preset to ones, the remainder is inverted and
+// sent MSB first, i.e. bit-reversed in the LSB-first octet.
+uint8_t ampdu_delimiter_crc(const uint8_t* delimiter)
+{
+    uint8_t crc = 0xff;
+    for (int i = 0; i < 16; i++) {
+        uint8_t bit = (delimiter[i / 8] >> (i % 8)) & 1;
+        uint8_t feedback = (crc >> 7) ^ bit;
+        crc <<= 1;
+        if (feedback) {
+            crc ^= 0x07;
+        }
+    }
+    crc ^= 0xff;
+
+    uint8_t out = 0;
+    for (int i = 0; i < 8; i++) {
+        out |= ((crc >> (7 - i)) & 1) << i;
+    }
+    return out;
+}
+
+int ampdu_mpdu_length(const uint8_t* delimiter)
+{
+    if (delimiter[3] != AMPDU_DELIMITER_SIGNATURE ||
+        delimiter[2] != ampdu_delimiter_crc(delimiter)) {
+        return -1;
+    }
+    return ((delimiter[0] >> 2) & 0x3) << 12 | (delimiter[0] >> 4) | delimiter[1] << 4;
+}
+
+void ampdu_delimiter(uint8_t* out, int mpdu_length, bool eof)
+{
+    out[0] = eof | ((mpdu_length >> 12) & 0x3) << 2 | (mpdu_length & 0xf) << 4;
+    out[1] = (mpdu_length >> 4) & 0xff;
+    out[2] = ampdu_delimiter_crc(out);
+    out[3] = AMPDU_DELIMITER_SIGNATURE;
+}
+
+int ampdu_fill_symbols(uint8_t* psdu, int len, ofdm_param& ofdm, bool ldpc)
+{
+    frame_param frame(ofdm, len, ldpc, true);
+    int end = ampdu_psdu_length(ofdm, frame.n_sym, ldpc, ldpc && frame.ldpc_params.extra);
+    end = std::min(end, MAX_AMPDU_SIZE);
+    // nothing to fill, callers reject PSDUs above MAX_AMPDU_SIZE
+    if (end <= len) {
+        return len;
+    }
 
-    //copy first 26 bits, inverting the first four
-    uint8_t num_crc_input_bytes = 4;
-    uint32_t crc4_input_bits = 0;
-    for(int i = 0; i < 26; i++){
-        crc4_input_bits += (i < 4 ? (1 - decoded_bits[i]) : (decoded_bits[i])) * pow(2, (31 - i));
+    // pad the last subframe, then EOF padding delimiters and up to 3 zero octets
+    int pos = std::min((len + 3) & ~3, end);
+    std::memset(psdu + len, 0, pos - len);
+    for (; pos + AMPDU_DELIMITER_SIZE <= end; pos += AMPDU_DELIMITER_SIZE) {
+        ampdu_delimiter(psdu + pos, 0, true);
     }
+    std::memset(psdu + pos, 0, end - pos);
 
-    /*
-    std::cout << "To 32: ";
-    std::cout << std::bitset<32>(crc4_input_bits);
-    std::cout << std::endl;
-    */
+    return end;
+}
 
-    //right shift by 6 (32 - 26) bits
-    crc4_input_bits = crc4_input_bits >> 6;
+std::string prepare_psdu(const pmt::pmt_t& msg,
+                         Encoding encoding,
+                         bool ldpc,
+                         ofdm_param& ofdm,
+                         uint8_t* buffer,
+                         tx_psdu& psdu)
+{
+    pmt::pmt_t meta = pmt::car(msg);
+    psdu.length = pmt::blob_length(pmt::cdr(msg));
+    psdu.data = static_cast<const char*>(pmt::blob_data(pmt::cdr(msg)));
+    psdu.aggregation = pmt::is_dict(meta) &&
+                       pmt::to_bool(pmt::dict_ref(meta, pmt::mp("aggregation"), pmt::PMT_F));
+
+    // the MCS can be chosen per packet, e.g. by rate control
+    pmt::pmt_t mcs =
+        pmt::is_dict(meta) ? pmt::dict_ref(meta, pmt::mp("encoding"), pmt::PMT_NIL)
+                           : pmt::PMT_NIL;
+    if (pmt::is_integer(mcs)) {
+        long e = pmt::to_long(mcs);
+        if (e < BPSK_1_2 || e > BPSK_1_2_REP) {
+            return "invalid encoding " + std::to_string(e);
+        }
+        encoding = Encoding(e);
+    }
+    if (encoding != ofdm.encoding) {
+        ofdm = ofdm_param(encoding);
+    }
 
-    //debug
-    /*
-    std::cout << "Right shift: ";
-    std::cout << std::bitset<32>(crc4_input_bits);
-    std::cout << std::endl;
-    */
-    
+    if (ldpc && ofdm.encoding == BPSK_1_2_REP) {
+        return "MCS10 does not support LDPC";
+    }
 
-    //split into 4 bytes (to hold the 32 bits)
-    uint8_t crc4_input_bytes[num_crc_input_bytes];
-    crc4_input_bytes[0] = (crc4_input_bits & 0xff000000) >> 24;
-    crc4_input_bytes[1] = (crc4_input_bits & 0x00ff0000) >> 16;
-    crc4_input_bytes[2] = (crc4_input_bits & 0x0000ff00) >> 8;
-    crc4_input_bytes[3] = (crc4_input_bits & 0x000000ff);
-
-    //debug
-    /*
-    dout << "Post Formating: ";
-    for(int i = 0; i < 4; i++){
-        std::cout << std::bitset<8>(crc4_input_bytes[i]);
-    }
-    dout << std::endl;
-    */
-    
+    if (psdu.aggregation) {
+        if (psdu.length > MAX_AMPDU_SIZE) {
+            return "A-MPDU too large, maximum size is " + std::to_string(MAX_AMPDU_SIZE) +
+                   " bytes";
+        }
+        frame_param frame(ofdm, psdu.length, ldpc, true);
+        if (frame.n_sym > MAX_AMPDU_SYM) {
+            return "A-MPDU too large, maximum number of symbols is " +
+                   std::to_string(MAX_AMPDU_SYM);
+        }
+        // the receiver takes the length from the number of symbols
+        std::memcpy(buffer, psdu.data, psdu.length);
+        psdu.length = ampdu_fill_symbols(buffer, psdu.length, ofdm, ldpc);
+        psdu.data = reinterpret_cast<const char*>(buffer);
+    }
 
-    uint8_t computed_crc = 0;
-    return crc4HaLoW_byte(computed_crc, crc4_input_bytes, num_crc_input_bytes);
-}
\ No newline at end of file
+    psdu.frame = frame_param(ofdm, psdu.length, ldpc, psdu.aggregation);
+    if (!psdu.aggregation && (psdu.frame.n_sym > MAX_SYM || psdu.length > MAX_PSDU_SIZE)) {
+        return "packet too large, maximum number of symbols is " + std::to_string(MAX_SYM);
+    }
+
+    return "";
+}
+
+uint32_t ndp_cts(int partial_ra, int duration, bool cf_end)
+{
+    return NDP_CTS | uint32_t(cf_end) << 3 | uint32_t(partial_ra & 0x1ff) << 4 |
+           uint32_t(duration & 0x3ff) << 13;
+}
+
+uint32_t ndp_ps_poll(int partial_bssid, int aid)
+{
+    return NDP_PS_POLL | uint32_t(partial_bssid & 0x1ff) << 3 |
+           uint32_t(aid & PV1_AID_MASK) << 12;
+}
+
+uint32_t ndp_ack(int ack_id, int duration, bool more_data)
+{
+    return NDP_ACK | uint32_t(ack_id & ((1 << NDP_ACK_ID_BITS) - 1)) << 3 |
+           uint32_t(more_data) << 12 | uint32_t(duration & 0x3ff) << 14;
+}
+
+int ndp_partial_address(const uint8_t* addr) { return (addr[4] >> 7) | addr[5] << 1; }
+
+int ndp_ack_id(const uint8_t* mpdu, int len)
+{
+    boost::crc_32_type fcs;
+    fcs.process_bytes(mpdu, len);
+    return fcs.checksum() & ((1 << NDP_ACK_ID_BITS) - 1);
+}
+
+pmt::pmt_t make_timestamp(uint64_t secs, double frac)
+{
+    return pmt::make_tuple(pmt::from_uint64(secs), pmt::from_double(frac));
+}
+
+pmt::pmt_t timestamp_add(const pmt::pmt_t& time, int64_t samples)
+{
+    // the full seconds stay exact, only the fraction is a double
+    int64_t secs = pmt::to_uint64(pmt::tuple_ref(time, 0)) + samples / SAMPLE_RATE;
+    double frac = pmt::to_double(pmt::tuple_ref(time, 1)) +
+                  double(samples % SAMPLE_RATE) / SAMPLE_RATE;
+    if (frac >= 1) {
+        secs++;
+        frac -= 1;
+    } else if (frac < 0) {
+        secs--;
+        frac += 1;
+    }
+    return make_timestamp(secs, frac);
+}
+
+int64_t timestamp_samples(const pmt::pmt_t& time)
+{
+    return pmt::to_uint64(pmt::tuple_ref(time, 0)) * SAMPLE_RATE +
+           std::llround(pmt::to_double(pmt::tuple_ref(time, 1)) * SAMPLE_RATE);
+}
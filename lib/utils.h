@@ -21,8 +21,11 @@
 #include <ieee802_11/api.h>
 #include <ieee802_11/mapper.h>
 #include <ieee802_11/constellations.h>
+#include "ldpc/ldpc.h"
+#include "numerology.h"
 #include <cinttypes>
 #include <iostream>
+#include <string>
 
 using gr::ieee802_11::Encoding;
 
@@ -42,12 +45,47 @@ using gr::ieee802_11::Encoding;
 #define MCS_FIRST_BIT_INDEX 7 //p.3246 of spec
 #define MCS_LAST_BIT_INDEX 10 //p.3246 of spec, inclusive
 #define SAMPLES_PER_GI 8 //for ieee802.11a/g, the GI is 0.8us. For 802.11ah, GI is 8us
+#define SAMPLES_PER_SHORT_GI 4 //short GI is 4us, used by the DATA symbols after the first one
+//samples from the first LTS to the DATA field: LTF1 starts with two LTS without GI, all following symbols have one
+#define DATA_FIELD_START                                                  \
+    (2 * SAMPLES_PER_OFDM_SYMBOL + (NUM_OFDM_SYMBOLS_IN_LTF1 - 2 +         \
+                                    NUM_OFDM_SYMBOLS_IN_SIG_FIELD) *       \
+                                       (SAMPLES_PER_OFDM_SYMBOL + SAMPLES_PER_GI))
+
+//the blocks run the 1 MHz numerology, the macros above are its hot path spelled out
+static_assert(SAMPLES_PER_OFDM_SYMBOL == gr::ieee802_11::halow_1mhz::FFT_SIZE &&
+                  CODED_BITS_PER_OFDM_SYMBOL == gr::ieee802_11::halow_1mhz::DATA_CARRIERS &&
+                  NUM_PILOTS == gr::ieee802_11::halow_1mhz::PILOTS &&
+                  PILOT1_INDEX == gr::ieee802_11::pilot_subcarrier<gr::ieee802_11::halow_1mhz>(0) &&
+                  PILOT2_INDEX == gr::ieee802_11::pilot_subcarrier<gr::ieee802_11::halow_1mhz>(1) &&
+                  SAMPLES_PER_GI == gr::ieee802_11::halow_1mhz::GI &&
+                  SAMPLES_PER_SHORT_GI == gr::ieee802_11::halow_1mhz::SHORT_GI &&
+                  NUM_OFDM_SYMBOLS_IN_LTF1 == gr::ieee802_11::halow_1mhz::LTF1_SYMBOLS &&
+                  NUM_OFDM_SYMBOLS_IN_SIG_FIELD == gr::ieee802_11::halow_1mhz::SIG_SYMBOLS &&
+                  NUM_BITS_IN_HALOW_SIG_FIELD == gr::ieee802_11::halow_1mhz::SIG_BITS,
+              "utils.h does not match the 1 MHz numerology");
 
 #define MAX_PAYLOAD_SIZE 1500
 #define MAX_PSDU_SIZE 511 //MAX_PSDU_SIZE is the maximum number of octets (or ofdm symbols) per Halow frames (length field in SIG is coded on 9 bits, see Table 23-18)
-#define MAX_SYM ((8 * MAX_PSDU_SIZE + 8 + 6) / 6)
-#define MAX_BITS_PER_SYM 160 //is this true for HaLow?
-#define MAX_ENCODED_BITS MAX_BITS_PER_SYM * MAX_PSDU_SIZE //is 16 samples per GI?
+#define MAX_DATA_BITS (8 * MAX_PSDU_SIZE + 8 + 6) //SERVICE field, PSDU and tail bits, Equation 23-79
+#define MAX_SYM ((MAX_DATA_BITS + 5) / 6) //MCS10 carries 6 data bits per symbol
+#define MAX_BITS_PER_SYM (CODED_BITS_PER_OFDM_SYMBOL * 8) //256-QAM on every data subcarrier
+//with aggregation the length field counts DATA symbols instead of octets (Table 23-18)
+#define MAX_AMPDU_SYM 511
+//largest aggregated PSDU, 511 symbols of 256-QAM 5/6 minus the SERVICE field;
+//LDPC has no tail bits, so it fits one octet more than BCC
+#define MAX_AMPDU_SIZE ((MAX_AMPDU_SYM * MAX_BITS_PER_SYM * 5 / 6 - 8) / 8)
+//an aggregated PPDU of 256-QAM symbols is longer than any single MPDU PPDU
+#define MAX_ENCODED_BITS ((MAX_AMPDU_SYM) * (MAX_BITS_PER_SYM))
+//one byte per data subcarrier of the longest frame (MCS10)
+#define MAX_FRAME_SYMBOLS ((MAX_SYM) * CODED_BITS_PER_OFDM_SYMBOL)
+//one byte per bit in every step of the TX coding chain, the largest is the
+//convolutional encoder output of 511 symbols of 256-QAM 5/6
+#define MAX_CODING_BITS (2 * (MAX_AMPDU_SYM) * (MAX_BITS_PER_SYM) * 5 / 6)
+
+//decoded bits are stored packed, MSB first
+#define GET_PACKED_BIT(buf, i) (((buf)[(i) >> 3] >> (7 - ((i) & 7))) & 1)
+#define SET_PACKED_BIT(buf, i) ((buf)[(i) >> 3] |= 0x80 >> ((i) & 7))
 
 #define dout d_debug&& std::cout
 #define mylog(...)                      \
@@ -69,6 +107,48 @@ struct mac_header {
 };
 #pragma pack(pop)
 
+/**
+ * S1G short MAC header (PV1, 9.8.4). Data frames between an AP and one of its
+ * stations carry the AID of the station in a two octet SID instead of its MAC
+ * address: with From DS set, A1 is the SID and A2 the BSSID, without it the
+ * other way round. Frame control: protocol version (B0-B1), type (B2-B4),
+ * PTID (B5-B7), From DS (B8), More Fragments (B9). The SID holds the AID
+ * (B0-B12) and whether A3 (B13) and A4 (B14) follow the sequence control.
+ */
+#define PV1_VERSION 1
+#define PV1_TYPE_QOS_DATA 0
+#define PV1_FROM_DS 0x0100
+#define PV1_MORE_FRAGMENTS 0x0200
+#define PV1_AID_MASK 0x1fff
+#define PV1_A3_PRESENT 0x2000
+#define PV1_A4_PRESENT 0x4000
+#define PV1_MAX_AID 8191
+// frame control, SID, BSSID and sequence control
+#define PV1_DATA_HEADER_SIZE 12
+
+struct pv1_header {
+    uint16_t frame_control;
+    bool from_ds;
+    int aid;
+    const uint8_t* bssid;
+    // nullptr if not present
+    const uint8_t* addr3;
+    uint16_t seq_nr;
+    int size;
+};
+
+// parses a PV1 QoS data header, false if the frame is none or too short
+bool parse_pv1_header(const uint8_t* mpdu, int len, pv1_header& header);
+
+// writes a PV1 QoS data header without A3 and A4 and returns its size
+int write_pv1_header(uint8_t* out,
+                     int tid,
+                     bool from_ds,
+                     int aid,
+                     const uint8_t* bssid,
+                     uint16_t seq_nr,
+                     bool more_frags);
+
 /**
  * WIFI parameters
  */
@@ -99,17 +179,26 @@ public:
 class frame_param
 {
 public:
-    frame_param(ofdm_param& ofdm, int psdu_length);//for DATA field
+    frame_param(ofdm_param& ofdm,
+                int psdu_length,
+                bool ldpc = false,
+                bool aggregation = false);//for DATA field
     frame_param(ofdm_param& ofdm);//for SIG field
     // PSDU size in bytes
     int psdu_size;
+    // LDPC instead of BCC, the DATA field is laid out by ldpc_params
+    bool ldpc;
+    gr::ieee802_11::ldpc_param ldpc_params;
+    // A-MPDU, SIG signals the number of symbols instead of the PSDU length
+    bool aggregation;
     // number of OFDM symbols (17-11)
     int n_sym;
     // number of padding bits in the DATA field (17-13)
     int n_pad;
     int n_encoded_bits;
-    // number of data bits, including service and padding (17-12)
-    uint16_t n_data_bits;
+    // number of data bits, including service and padding (17-12), for LDPC
+    // just service and PSDU
+    int n_data_bits;
 
     void print();
 };
@@ -147,6 +236,21 @@ void split_symbols(const char* input, char* out, frame_param& frame, ofdm_param&
 
 void generate_bits(const char* psdu, char* data_bits, frame_param& frame);
 
+/**
+ * Runs a PSDU through the complete DATA field coding chain (service and pad
+ * bits, scrambling, convolutional encoding, puncturing, repetition for MCS10
+ * and interleaving, or LDPC encoding and tone mapping) and writes one byte
+ * per data subcarrier to symbols.
+ * work0 and work1 are scratch buffers of MAX_CODING_BITS bytes each.
+ */
+void encode_data_field(const char* psdu,
+                       char* symbols,
+                       char* work0,
+                       char* work1,
+                       frame_param& frame,
+                       ofdm_param& ofdm,
+                       char scrambler);
+
 
 /**
  * Variables and functions related to frame decoding
@@ -170,174 +274,105 @@ const int interleaver_pattern[CODED_BITS_PER_OFDM_SYMBOL] = {
     2, 5, 8, 11, 14, 17, 20, 23
 }; //table 23-20 and table 23-41
 
-uint8_t compute_crc(uint8_t* crc_input);
-uint8_t crc4HaLoW_byte(uint8_t crc, void const *mem, size_t len);
-
-// Table for CRC4 computation
-// This code was partially generated from the crcany program of Mark Adler (see https://github.com/madler/crcany)
-#define table_byte table_word[0]
-
-static uint8_t const table_word[][256] = {
-   {0x00, 0x30, 0x60, 0x50, 0xc0, 0xf0, 0xa0, 0x90, 0xb0, 0x80, 0xd0, 0xe0, 0x70,
-    0x40, 0x10, 0x20, 0x50, 0x60, 0x30, 0x00, 0x90, 0xa0, 0xf0, 0xc0, 0xe0, 0xd0,
-    0x80, 0xb0, 0x20, 0x10, 0x40, 0x70, 0xa0, 0x90, 0xc0, 0xf0, 0x60, 0x50, 0x00,
-    0x30, 0x10, 0x20, 0x70, 0x40, 0xd0, 0xe0, 0xb0, 0x80, 0xf0, 0xc0, 0x90, 0xa0,
-    0x30, 0x00, 0x50, 0x60, 0x40, 0x70, 0x20, 0x10, 0x80, 0xb0, 0xe0, 0xd0, 0x70,
-    0x40, 0x10, 0x20, 0xb0, 0x80, 0xd0, 0xe0, 0xc0, 0xf0, 0xa0, 0x90, 0x00, 0x30,
-    0x60, 0x50, 0x20, 0x10, 0x40, 0x70, 0xe0, 0xd0, 0x80, 0xb0, 0x90, 0xa0, 0xf0,
-    0xc0, 0x50, 0x60, 0x30, 0x00, 0xd0, 0xe0, 0xb0, 0x80, 0x10, 0x20, 0x70, 0x40,
-    0x60, 0x50, 0x00, 0x30, 0xa0, 0x90, 0xc0, 0xf0, 0x80, 0xb0, 0xe0, 0xd0, 0x40,
-    0x70, 0x20, 0x10, 0x30, 0x00, 0x50, 0x60, 0xf0, 0xc0, 0x90, 0xa0, 0xe0, 0xd0,
-    0x80, 0xb0, 0x20, 0x10, 0x40, 0x70, 0x50, 0x60, 0x30, 0x00, 0x90, 0xa0, 0xf0,
-    0xc0, 0xb0, 0x80, 0xd0, 0xe0, 0x70, 0x40, 0x10, 0x20, 0x00, 0x30, 0x60, 0x50,
-    0xc0, 0xf0, 0xa0, 0x90, 0x40, 0x70, 0x20, 0x10, 0x80, 0xb0, 0xe0, 0xd0, 0xf0,
-    0xc0, 0x90, 0xa0, 0x30, 0x00, 0x50, 0x60, 0x10, 0x20, 0x70, 0x40, 0xd0, 0xe0,
-    0xb0, 0x80, 0xa0, 0x90, 0xc0, 0xf0, 0x60, 0x50, 0x00, 0x30, 0x90, 0xa0, 0xf0,
-    0xc0, 0x50, 0x60, 0x30, 0x00, 0x20, 0x10, 0x40, 0x70, 0xe0, 0xd0, 0x80, 0xb0,
-    0xc0, 0xf0, 0xa0, 0x90, 0x00, 0x30, 0x60, 0x50, 0x70, 0x40, 0x10, 0x20, 0xb0,
-    0x80, 0xd0, 0xe0, 0x30, 0x00, 0x50, 0x60, 0xf0, 0xc0, 0x90, 0xa0, 0x80, 0xb0,
-    0xe0, 0xd0, 0x40, 0x70, 0x20, 0x10, 0x60, 0x50, 0x00, 0x30, 0xa0, 0x90, 0xc0,
-    0xf0, 0xd0, 0xe0, 0xb0, 0x80, 0x10, 0x20, 0x70, 0x40},
-   {0x00, 0xf0, 0xd0, 0x20, 0x90, 0x60, 0x40, 0xb0, 0x10, 0xe0, 0xc0, 0x30, 0x80,
-    0x70, 0x50, 0xa0, 0x20, 0xd0, 0xf0, 0x00, 0xb0, 0x40, 0x60, 0x90, 0x30, 0xc0,
-    0xe0, 0x10, 0xa0, 0x50, 0x70, 0x80, 0x40, 0xb0, 0x90, 0x60, 0xd0, 0x20, 0x00,
-    0xf0, 0x50, 0xa0, 0x80, 0x70, 0xc0, 0x30, 0x10, 0xe0, 0x60, 0x90, 0xb0, 0x40,
-    0xf0, 0x00, 0x20, 0xd0, 0x70, 0x80, 0xa0, 0x50, 0xe0, 0x10, 0x30, 0xc0, 0x80,
-    0x70, 0x50, 0xa0, 0x10, 0xe0, 0xc0, 0x30, 0x90, 0x60, 0x40, 0xb0, 0x00, 0xf0,
-    0xd0, 0x20, 0xa0, 0x50, 0x70, 0x80, 0x30, 0xc0, 0xe0, 0x10, 0xb0, 0x40, 0x60,
-    0x90, 0x20, 0xd0, 0xf0, 0x00, 0xc0, 0x30, 0x10, 0xe0, 0x50, 0xa0, 0x80, 0x70,
-    0xd0, 0x20, 0x00, 0xf0, 0x40, 0xb0, 0x90, 0x60, 0xe0, 0x10, 0x30, 0xc0, 0x70,
-    0x80, 0xa0, 0x50, 0xf0, 0x00, 0x20, 0xd0, 0x60, 0x90, 0xb0, 0x40, 0x30, 0xc0,
-    0xe0, 0x10, 0xa0, 0x50, 0x70, 0x80, 0x20, 0xd0, 0xf0, 0x00, 0xb0, 0x40, 0x60,
-    0x90, 0x10, 0xe0, 0xc0, 0x30, 0x80, 0x70, 0x50, 0xa0, 0x00, 0xf0, 0xd0, 0x20,
-    0x90, 0x60, 0x40, 0xb0, 0x70, 0x80, 0xa0, 0x50, 0xe0, 0x10, 0x30, 0xc0, 0x60,
-    0x90, 0xb0, 0x40, 0xf0, 0x00, 0x20, 0xd0, 0x50, 0xa0, 0x80, 0x70, 0xc0, 0x30,
-    0x10, 0xe0, 0x40, 0xb0, 0x90, 0x60, 0xd0, 0x20, 0x00, 0xf0, 0xb0, 0x40, 0x60,
-    0x90, 0x20, 0xd0, 0xf0, 0x00, 0xa0, 0x50, 0x70, 0x80, 0x30, 0xc0, 0xe0, 0x10,
-    0x90, 0x60, 0x40, 0xb0, 0x00, 0xf0, 0xd0, 0x20, 0x80, 0x70, 0x50, 0xa0, 0x10,
-    0xe0, 0xc0, 0x30, 0xf0, 0x00, 0x20, 0xd0, 0x60, 0x90, 0xb0, 0x40, 0xe0, 0x10,
-    0x30, 0xc0, 0x70, 0x80, 0xa0, 0x50, 0xd0, 0x20, 0x00, 0xf0, 0x40, 0xb0, 0x90,
-    0x60, 0xc0, 0x30, 0x10, 0xe0, 0x50, 0xa0, 0x80, 0x70},
-   {0x00, 0x60, 0xc0, 0xa0, 0xb0, 0xd0, 0x70, 0x10, 0x50, 0x30, 0x90, 0xf0, 0xe0,
-    0x80, 0x20, 0x40, 0xa0, 0xc0, 0x60, 0x00, 0x10, 0x70, 0xd0, 0xb0, 0xf0, 0x90,
-    0x30, 0x50, 0x40, 0x20, 0x80, 0xe0, 0x70, 0x10, 0xb0, 0xd0, 0xc0, 0xa0, 0x00,
-    0x60, 0x20, 0x40, 0xe0, 0x80, 0x90, 0xf0, 0x50, 0x30, 0xd0, 0xb0, 0x10, 0x70,
-    0x60, 0x00, 0xa0, 0xc0, 0x80, 0xe0, 0x40, 0x20, 0x30, 0x50, 0xf0, 0x90, 0xe0,
-    0x80, 0x20, 0x40, 0x50, 0x30, 0x90, 0xf0, 0xb0, 0xd0, 0x70, 0x10, 0x00, 0x60,
-    0xc0, 0xa0, 0x40, 0x20, 0x80, 0xe0, 0xf0, 0x90, 0x30, 0x50, 0x10, 0x70, 0xd0,
-    0xb0, 0xa0, 0xc0, 0x60, 0x00, 0x90, 0xf0, 0x50, 0x30, 0x20, 0x40, 0xe0, 0x80,
-    0xc0, 0xa0, 0x00, 0x60, 0x70, 0x10, 0xb0, 0xd0, 0x30, 0x50, 0xf0, 0x90, 0x80,
-    0xe0, 0x40, 0x20, 0x60, 0x00, 0xa0, 0xc0, 0xd0, 0xb0, 0x10, 0x70, 0xf0, 0x90,
-    0x30, 0x50, 0x40, 0x20, 0x80, 0xe0, 0xa0, 0xc0, 0x60, 0x00, 0x10, 0x70, 0xd0,
-    0xb0, 0x50, 0x30, 0x90, 0xf0, 0xe0, 0x80, 0x20, 0x40, 0x00, 0x60, 0xc0, 0xa0,
-    0xb0, 0xd0, 0x70, 0x10, 0x80, 0xe0, 0x40, 0x20, 0x30, 0x50, 0xf0, 0x90, 0xd0,
-    0xb0, 0x10, 0x70, 0x60, 0x00, 0xa0, 0xc0, 0x20, 0x40, 0xe0, 0x80, 0x90, 0xf0,
-    0x50, 0x30, 0x70, 0x10, 0xb0, 0xd0, 0xc0, 0xa0, 0x00, 0x60, 0x10, 0x70, 0xd0,
-    0xb0, 0xa0, 0xc0, 0x60, 0x00, 0x40, 0x20, 0x80, 0xe0, 0xf0, 0x90, 0x30, 0x50,
-    0xb0, 0xd0, 0x70, 0x10, 0x00, 0x60, 0xc0, 0xa0, 0xe0, 0x80, 0x20, 0x40, 0x50,
-    0x30, 0x90, 0xf0, 0x60, 0x00, 0xa0, 0xc0, 0xd0, 0xb0, 0x10, 0x70, 0x30, 0x50,
-    0xf0, 0x90, 0x80, 0xe0, 0x40, 0x20, 0xc0, 0xa0, 0x00, 0x60, 0x70, 0x10, 0xb0,
-    0xd0, 0x90, 0xf0, 0x50, 0x30, 0x20, 0x40, 0xe0, 0x80},
-   {0x00, 0xd0, 0x90, 0x40, 0x10, 0xc0, 0x80, 0x50, 0x20, 0xf0, 0xb0, 0x60, 0x30,
-    0xe0, 0xa0, 0x70, 0x40, 0x90, 0xd0, 0x00, 0x50, 0x80, 0xc0, 0x10, 0x60, 0xb0,
-    0xf0, 0x20, 0x70, 0xa0, 0xe0, 0x30, 0x80, 0x50, 0x10, 0xc0, 0x90, 0x40, 0x00,
-    0xd0, 0xa0, 0x70, 0x30, 0xe0, 0xb0, 0x60, 0x20, 0xf0, 0xc0, 0x10, 0x50, 0x80,
-    0xd0, 0x00, 0x40, 0x90, 0xe0, 0x30, 0x70, 0xa0, 0xf0, 0x20, 0x60, 0xb0, 0x30,
-    0xe0, 0xa0, 0x70, 0x20, 0xf0, 0xb0, 0x60, 0x10, 0xc0, 0x80, 0x50, 0x00, 0xd0,
-    0x90, 0x40, 0x70, 0xa0, 0xe0, 0x30, 0x60, 0xb0, 0xf0, 0x20, 0x50, 0x80, 0xc0,
-    0x10, 0x40, 0x90, 0xd0, 0x00, 0xb0, 0x60, 0x20, 0xf0, 0xa0, 0x70, 0x30, 0xe0,
-    0x90, 0x40, 0x00, 0xd0, 0x80, 0x50, 0x10, 0xc0, 0xf0, 0x20, 0x60, 0xb0, 0xe0,
-    0x30, 0x70, 0xa0, 0xd0, 0x00, 0x40, 0x90, 0xc0, 0x10, 0x50, 0x80, 0x60, 0xb0,
-    0xf0, 0x20, 0x70, 0xa0, 0xe0, 0x30, 0x40, 0x90, 0xd0, 0x00, 0x50, 0x80, 0xc0,
-    0x10, 0x20, 0xf0, 0xb0, 0x60, 0x30, 0xe0, 0xa0, 0x70, 0x00, 0xd0, 0x90, 0x40,
-    0x10, 0xc0, 0x80, 0x50, 0xe0, 0x30, 0x70, 0xa0, 0xf0, 0x20, 0x60, 0xb0, 0xc0,
-    0x10, 0x50, 0x80, 0xd0, 0x00, 0x40, 0x90, 0xa0, 0x70, 0x30, 0xe0, 0xb0, 0x60,
-    0x20, 0xf0, 0x80, 0x50, 0x10, 0xc0, 0x90, 0x40, 0x00, 0xd0, 0x50, 0x80, 0xc0,
-    0x10, 0x40, 0x90, 0xd0, 0x00, 0x70, 0xa0, 0xe0, 0x30, 0x60, 0xb0, 0xf0, 0x20,
-    0x10, 0xc0, 0x80, 0x50, 0x00, 0xd0, 0x90, 0x40, 0x30, 0xe0, 0xa0, 0x70, 0x20,
-    0xf0, 0xb0, 0x60, 0xd0, 0x00, 0x40, 0x90, 0xc0, 0x10, 0x50, 0x80, 0xf0, 0x20,
-    0x60, 0xb0, 0xe0, 0x30, 0x70, 0xa0, 0x90, 0x40, 0x00, 0xd0, 0x80, 0x50, 0x10,
-    0xc0, 0xb0, 0x60, 0x20, 0xf0, 0xa0, 0x70, 0x30, 0xe0},
-   {0x00, 0xc0, 0xb0, 0x70, 0x50, 0x90, 0xe0, 0x20, 0xa0, 0x60, 0x10, 0xd0, 0xf0,
-    0x30, 0x40, 0x80, 0x70, 0xb0, 0xc0, 0x00, 0x20, 0xe0, 0x90, 0x50, 0xd0, 0x10,
-    0x60, 0xa0, 0x80, 0x40, 0x30, 0xf0, 0xe0, 0x20, 0x50, 0x90, 0xb0, 0x70, 0x00,
-    0xc0, 0x40, 0x80, 0xf0, 0x30, 0x10, 0xd0, 0xa0, 0x60, 0x90, 0x50, 0x20, 0xe0,
-    0xc0, 0x00, 0x70, 0xb0, 0x30, 0xf0, 0x80, 0x40, 0x60, 0xa0, 0xd0, 0x10, 0xf0,
-    0x30, 0x40, 0x80, 0xa0, 0x60, 0x10, 0xd0, 0x50, 0x90, 0xe0, 0x20, 0x00, 0xc0,
-    0xb0, 0x70, 0x80, 0x40, 0x30, 0xf0, 0xd0, 0x10, 0x60, 0xa0, 0x20, 0xe0, 0x90,
-    0x50, 0x70, 0xb0, 0xc0, 0x00, 0x10, 0xd0, 0xa0, 0x60, 0x40, 0x80, 0xf0, 0x30,
-    0xb0, 0x70, 0x00, 0xc0, 0xe0, 0x20, 0x50, 0x90, 0x60, 0xa0, 0xd0, 0x10, 0x30,
-    0xf0, 0x80, 0x40, 0xc0, 0x00, 0x70, 0xb0, 0x90, 0x50, 0x20, 0xe0, 0xd0, 0x10,
-    0x60, 0xa0, 0x80, 0x40, 0x30, 0xf0, 0x70, 0xb0, 0xc0, 0x00, 0x20, 0xe0, 0x90,
-    0x50, 0xa0, 0x60, 0x10, 0xd0, 0xf0, 0x30, 0x40, 0x80, 0x00, 0xc0, 0xb0, 0x70,
-    0x50, 0x90, 0xe0, 0x20, 0x30, 0xf0, 0x80, 0x40, 0x60, 0xa0, 0xd0, 0x10, 0x90,
-    0x50, 0x20, 0xe0, 0xc0, 0x00, 0x70, 0xb0, 0x40, 0x80, 0xf0, 0x30, 0x10, 0xd0,
-    0xa0, 0x60, 0xe0, 0x20, 0x50, 0x90, 0xb0, 0x70, 0x00, 0xc0, 0x20, 0xe0, 0x90,
-    0x50, 0x70, 0xb0, 0xc0, 0x00, 0x80, 0x40, 0x30, 0xf0, 0xd0, 0x10, 0x60, 0xa0,
-    0x50, 0x90, 0xe0, 0x20, 0x00, 0xc0, 0xb0, 0x70, 0xf0, 0x30, 0x40, 0x80, 0xa0,
-    0x60, 0x10, 0xd0, 0xc0, 0x00, 0x70, 0xb0, 0x90, 0x50, 0x20, 0xe0, 0x60, 0xa0,
-    0xd0, 0x10, 0x30, 0xf0, 0x80, 0x40, 0xb0, 0x70, 0x00, 0xc0, 0xe0, 0x20, 0x50,
-    0x90, 0x10, 0xd0, 0xa0, 0x60, 0x40, 0x80, 0xf0, 0x30},
-   {0x00, 0x90, 0x10, 0x80, 0x20, 0xb0, 0x30, 0xa0, 0x40, 0xd0, 0x50, 0xc0, 0x60,
-    0xf0, 0x70, 0xe0, 0x80, 0x10, 0x90, 0x00, 0xa0, 0x30, 0xb0, 0x20, 0xc0, 0x50,
-    0xd0, 0x40, 0xe0, 0x70, 0xf0, 0x60, 0x30, 0xa0, 0x20, 0xb0, 0x10, 0x80, 0x00,
-    0x90, 0x70, 0xe0, 0x60, 0xf0, 0x50, 0xc0, 0x40, 0xd0, 0xb0, 0x20, 0xa0, 0x30,
-    0x90, 0x00, 0x80, 0x10, 0xf0, 0x60, 0xe0, 0x70, 0xd0, 0x40, 0xc0, 0x50, 0x60,
-    0xf0, 0x70, 0xe0, 0x40, 0xd0, 0x50, 0xc0, 0x20, 0xb0, 0x30, 0xa0, 0x00, 0x90,
-    0x10, 0x80, 0xe0, 0x70, 0xf0, 0x60, 0xc0, 0x50, 0xd0, 0x40, 0xa0, 0x30, 0xb0,
-    0x20, 0x80, 0x10, 0x90, 0x00, 0x50, 0xc0, 0x40, 0xd0, 0x70, 0xe0, 0x60, 0xf0,
-    0x10, 0x80, 0x00, 0x90, 0x30, 0xa0, 0x20, 0xb0, 0xd0, 0x40, 0xc0, 0x50, 0xf0,
-    0x60, 0xe0, 0x70, 0x90, 0x00, 0x80, 0x10, 0xb0, 0x20, 0xa0, 0x30, 0xc0, 0x50,
-    0xd0, 0x40, 0xe0, 0x70, 0xf0, 0x60, 0x80, 0x10, 0x90, 0x00, 0xa0, 0x30, 0xb0,
-    0x20, 0x40, 0xd0, 0x50, 0xc0, 0x60, 0xf0, 0x70, 0xe0, 0x00, 0x90, 0x10, 0x80,
-    0x20, 0xb0, 0x30, 0xa0, 0xf0, 0x60, 0xe0, 0x70, 0xd0, 0x40, 0xc0, 0x50, 0xb0,
-    0x20, 0xa0, 0x30, 0x90, 0x00, 0x80, 0x10, 0x70, 0xe0, 0x60, 0xf0, 0x50, 0xc0,
-    0x40, 0xd0, 0x30, 0xa0, 0x20, 0xb0, 0x10, 0x80, 0x00, 0x90, 0xa0, 0x30, 0xb0,
-    0x20, 0x80, 0x10, 0x90, 0x00, 0xe0, 0x70, 0xf0, 0x60, 0xc0, 0x50, 0xd0, 0x40,
-    0x20, 0xb0, 0x30, 0xa0, 0x00, 0x90, 0x10, 0x80, 0x60, 0xf0, 0x70, 0xe0, 0x40,
-    0xd0, 0x50, 0xc0, 0x90, 0x00, 0x80, 0x10, 0xb0, 0x20, 0xa0, 0x30, 0xd0, 0x40,
-    0xc0, 0x50, 0xf0, 0x60, 0xe0, 0x70, 0x10, 0x80, 0x00, 0x90, 0x30, 0xa0, 0x20,
-    0xb0, 0x50, 0xc0, 0x40, 0xd0, 0x70, 0xe0, 0x60, 0xf0},
-   {0x00, 0xb0, 0x50, 0xe0, 0xa0, 0x10, 0xf0, 0x40, 0x70, 0xc0, 0x20, 0x90, 0xd0,
-    0x60, 0x80, 0x30, 0xe0, 0x50, 0xb0, 0x00, 0x40, 0xf0, 0x10, 0xa0, 0x90, 0x20,
-    0xc0, 0x70, 0x30, 0x80, 0x60, 0xd0, 0xf0, 0x40, 0xa0, 0x10, 0x50, 0xe0, 0x00,
-    0xb0, 0x80, 0x30, 0xd0, 0x60, 0x20, 0x90, 0x70, 0xc0, 0x10, 0xa0, 0x40, 0xf0,
-    0xb0, 0x00, 0xe0, 0x50, 0x60, 0xd0, 0x30, 0x80, 0xc0, 0x70, 0x90, 0x20, 0xd0,
-    0x60, 0x80, 0x30, 0x70, 0xc0, 0x20, 0x90, 0xa0, 0x10, 0xf0, 0x40, 0x00, 0xb0,
-    0x50, 0xe0, 0x30, 0x80, 0x60, 0xd0, 0x90, 0x20, 0xc0, 0x70, 0x40, 0xf0, 0x10,
-    0xa0, 0xe0, 0x50, 0xb0, 0x00, 0x20, 0x90, 0x70, 0xc0, 0x80, 0x30, 0xd0, 0x60,
-    0x50, 0xe0, 0x00, 0xb0, 0xf0, 0x40, 0xa0, 0x10, 0xc0, 0x70, 0x90, 0x20, 0x60,
-    0xd0, 0x30, 0x80, 0xb0, 0x00, 0xe0, 0x50, 0x10, 0xa0, 0x40, 0xf0, 0x90, 0x20,
-    0xc0, 0x70, 0x30, 0x80, 0x60, 0xd0, 0xe0, 0x50, 0xb0, 0x00, 0x40, 0xf0, 0x10,
-    0xa0, 0x70, 0xc0, 0x20, 0x90, 0xd0, 0x60, 0x80, 0x30, 0x00, 0xb0, 0x50, 0xe0,
-    0xa0, 0x10, 0xf0, 0x40, 0x60, 0xd0, 0x30, 0x80, 0xc0, 0x70, 0x90, 0x20, 0x10,
-    0xa0, 0x40, 0xf0, 0xb0, 0x00, 0xe0, 0x50, 0x80, 0x30, 0xd0, 0x60, 0x20, 0x90,
-    0x70, 0xc0, 0xf0, 0x40, 0xa0, 0x10, 0x50, 0xe0, 0x00, 0xb0, 0x40, 0xf0, 0x10,
-    0xa0, 0xe0, 0x50, 0xb0, 0x00, 0x30, 0x80, 0x60, 0xd0, 0x90, 0x20, 0xc0, 0x70,
-    0xa0, 0x10, 0xf0, 0x40, 0x00, 0xb0, 0x50, 0xe0, 0xd0, 0x60, 0x80, 0x30, 0x70,
-    0xc0, 0x20, 0x90, 0xb0, 0x00, 0xe0, 0x50, 0x10, 0xa0, 0x40, 0xf0, 0xc0, 0x70,
-    0x90, 0x20, 0x60, 0xd0, 0x30, 0x80, 0x50, 0xe0, 0x00, 0xb0, 0xf0, 0x40, 0xa0,
-    0x10, 0x20, 0x90, 0x70, 0xc0, 0x80, 0x30, 0xd0, 0x60},
-   {0x00, 0x10, 0x20, 0x30, 0x40, 0x50, 0x60, 0x70, 0x80, 0x90, 0xa0, 0xb0, 0xc0,
-    0xd0, 0xe0, 0xf0, 0x30, 0x20, 0x10, 0x00, 0x70, 0x60, 0x50, 0x40, 0xb0, 0xa0,
-    0x90, 0x80, 0xf0, 0xe0, 0xd0, 0xc0, 0x60, 0x70, 0x40, 0x50, 0x20, 0x30, 0x00,
-    0x10, 0xe0, 0xf0, 0xc0, 0xd0, 0xa0, 0xb0, 0x80, 0x90, 0x50, 0x40, 0x70, 0x60,
-    0x10, 0x00, 0x30, 0x20, 0xd0, 0xc0, 0xf0, 0xe0, 0x90, 0x80, 0xb0, 0xa0, 0xc0,
-    0xd0, 0xe0, 0xf0, 0x80, 0x90, 0xa0, 0xb0, 0x40, 0x50, 0x60, 0x70, 0x00, 0x10,
-    0x20, 0x30, 0xf0, 0xe0, 0xd0, 0xc0, 0xb0, 0xa0, 0x90, 0x80, 0x70, 0x60, 0x50,
-    0x40, 0x30, 0x20, 0x10, 0x00, 0xa0, 0xb0, 0x80, 0x90, 0xe0, 0xf0, 0xc0, 0xd0,
-    0x20, 0x30, 0x00, 0x10, 0x60, 0x70, 0x40, 0x50, 0x90, 0x80, 0xb0, 0xa0, 0xd0,
-    0xc0, 0xf0, 0xe0, 0x10, 0x00, 0x30, 0x20, 0x50, 0x40, 0x70, 0x60, 0xb0, 0xa0,
-    0x90, 0x80, 0xf0, 0xe0, 0xd0, 0xc0, 0x30, 0x20, 0x10, 0x00, 0x70, 0x60, 0x50,
-    0x40, 0x80, 0x90, 0xa0, 0xb0, 0xc0, 0xd0, 0xe0, 0xf0, 0x00, 0x10, 0x20, 0x30,
-    0x40, 0x50, 0x60, 0x70, 0xd0, 0xc0, 0xf0, 0xe0, 0x90, 0x80, 0xb0, 0xa0, 0x50,
-    0x40, 0x70, 0x60, 0x10, 0x00, 0x30, 0x20, 0xe0, 0xf0, 0xc0, 0xd0, 0xa0, 0xb0,
-    0x80, 0x90, 0x60, 0x70, 0x40, 0x50, 0x20, 0x30, 0x00, 0x10, 0x70, 0x60, 0x50,
-    0x40, 0x30, 0x20, 0x10, 0x00, 0xf0, 0xe0, 0xd0, 0xc0, 0xb0, 0xa0, 0x90, 0x80,
-    0x40, 0x50, 0x60, 0x70, 0x00, 0x10, 0x20, 0x30, 0xc0, 0xd0, 0xe0, 0xf0, 0x80,
-    0x90, 0xa0, 0xb0, 0x10, 0x00, 0x30, 0x20, 0x50, 0x40, 0x70, 0x60, 0x90, 0x80,
-    0xb0, 0xa0, 0xd0, 0xc0, 0xf0, 0xe0, 0x20, 0x30, 0x00, 0x10, 0x60, 0x70, 0x40,
-    0x50, 0xa0, 0xb0, 0x80, 0x90, 0xe0, 0xf0, 0xc0, 0xd0}
+uint8_t compute_crc(const uint8_t* crc_input);
+
+/**
+ * A-MPDU. With the Aggregation bit of SIG set, the PSDU is a sequence of
+ * subframes: a 4 octet MPDU delimiter, the MPDU and padding to a multiple of
+ * 4 octets. The delimiter holds EOF (B0), the MPDU length (B2-B15, same bit
+ * order as VHT), a CRC-8 over B0-B15 and the signature.
+ */
+#define AMPDU_DELIMITER_SIZE 4
+#define AMPDU_DELIMITER_SIGNATURE 0x4e
+
+// length of the PSDU that fills n_sym DATA symbols of an aggregated PPDU
+int ampdu_psdu_length(ofdm_param& ofdm, int n_sym, bool ldpc = false, bool ldpc_extra = false);
+
+// CRC-8 of the first two octets of an MPDU delimiter
+uint8_t ampdu_delimiter_crc(const uint8_t* delimiter);
+
+// MPDU length of a delimiter, -1 if signature or CRC do not match
+int ampdu_mpdu_length(const uint8_t* delimiter);
+
+void ampdu_delimiter(uint8_t* out, int mpdu_length, bool eof);
+
+// appends EOF padding so that the A-MPDU fills its last DATA symbol and
+// returns the new PSDU length, psdu has room for MAX_AMPDU_SIZE bytes
+int ampdu_fill_symbols(uint8_t* psdu, int len, ofdm_param& ofdm, bool ldpc = false);
+
+/**
+ * A PSDU of the MAC, checked and ready for the mapper or the OFDM modulator
+ * to encode. data points into the PDU, or into the buffer for A-MPDUs.
+ */
+struct tx_psdu {
+    explicit tx_psdu(ofdm_param& ofdm) : data(nullptr), length(0), aggregation(false), frame(ofdm) {}
+    const char* data;
+    int length;
+    bool aggregation;
+    frame_param frame;
 };
 
+/**
+ * Reads a PDU of the MAC into psdu. The "encoding" in the metadata overrides
+ * the encoding of the block, ofdm is replaced when it differs. A-MPDUs get
+ * EOF padding up to their last symbol in buffer, which has room for
+ * MAX_AMPDU_SIZE bytes. Returns why the packet has to be dropped, or an empty
+ * string.
+ */
+std::string prepare_psdu(const pmt::pmt_t& msg,
+                         Encoding encoding,
+                         bool ldpc,
+                         ofdm_param& ofdm,
+                         uint8_t* buffer,
+                         tx_psdu& psdu);
+
+/**
+ * S1G NDP CMAC frames (1 MHz, 9.9). The SIG field has the NDP Indication bit
+ * (B25) set and carries a 25 bit frame body (B0-B24) instead of MCS and
+ * length, there is no DATA field. B0-B2 are the frame type:
+ * - NDP CTS: CF-End (B3), partial RA (B4-B12), Duration (B13-B22)
+ * - NDP PS-Poll: partial BSSID (B3-B11), AID of the TA (B12-B24)
+ * - NDP ACK: Ack ID (B3-B11), More Data (B12), Idle Indication (B13),
+ *   Duration (B14-B23), Relayed Frame (B24)
+ * Between the blocks, an NDP is a PDU with an empty blob and the body as an
+ * integer under "ndp" in the metadata.
+ */
+#define NDP_BODY_BITS 25
+#define NDP_ACK_ID_BITS 9
+
+enum ndp_type { NDP_CTS = 0, NDP_PS_POLL = 1, NDP_ACK = 2 };
+
+inline int ndp_field(uint32_t body, int first, int bits)
+{
+    return (body >> first) & ((1 << bits) - 1);
+}
+
+uint32_t ndp_cts(int partial_ra, int duration, bool cf_end = false);
+uint32_t ndp_ps_poll(int partial_bssid, int aid);
+uint32_t ndp_ack(int ack_id, int duration = 0, bool more_data = false);
+
+// 9 bit partial address of a MAC address, its bits 39 to 47
+int ndp_partial_address(const uint8_t* addr);
+
+// Ack ID that acknowledges an MPDU, the low bits of its FCS, len without FCS
+int ndp_ack_id(const uint8_t* mpdu, int len);
+
+/**
+ * Sample clock timestamps. They are pmt tuples of full and fractional
+ * seconds, like the rx_time and tx_time tags of UHD. Without an rx_time tag
+ * on the received stream, the clock starts at zero with its first sample.
+ */
+// the 1 MHz PHY runs at one sample per microsecond
+#define SAMPLE_RATE 1000000
+// aSIFSTime of the 1 MHz PHY, in samples
+#define SIFS_SAMPLES 160
+// aSlotTime of the 1 MHz PHY, in samples
+#define SLOT_SAMPLES 52
+
+pmt::pmt_t make_timestamp(uint64_t secs, double frac);
+// the timestamp samples later (or earlier, if negative)
+pmt::pmt_t timestamp_add(const pmt::pmt_t& time, int64_t samples);
+// samples since the start of the clock, for time differences
+int64_t timestamp_samples(const pmt::pmt_t& time);
+
 #endif /* INCLUDED_IEEE802_11_UTILS_H */
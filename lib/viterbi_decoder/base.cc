@@ -25,40 +25,46 @@ base::base() : d_store_pos(0) {}
 
 base::~base() {}
 
-uint8_t* base::depuncture(uint8_t* in)
+void base::depuncture_init()
 {
+    d_in_pos = 0;
+    d_in_len = d_frame->n_sym * d_ofdm->n_cbps;
+    d_pattern_pos = 0;
+}
 
-    int count;
-    int n_cbps = d_ofdm->n_cbps;
-    uint8_t* depunctured;
-
-    if (d_ntraceback == 5) {
-        count = d_frame->n_sym * n_cbps;
-        depunctured = in;
-
-    } else {
-        depunctured = d_depunctured;
-        count = 0;
-        for (int i = 0; i < d_frame->n_sym; i++) {
-            for (int k = 0; k < n_cbps; k++) {
-                while (d_depuncture_pattern[count % (2 * d_k)] == 0) {
-                    depunctured[count] = 2;
-                    count++;
-                }
+/* Depuncturing is done on the fly: instead of expanding the whole frame
+ * into a separate buffer, the next four trellis symbols are gathered
+ * straight from the packed soft bits, following the periodic puncture
+ * pattern. Punctured positions and everything past the end of the frame
+ * (the decoder runs beyond it for the traceback) are fed as erasures
+ * (SOFT_ERASURE).
+ */
+const uint8_t* base::depuncture_next(const uint8_t* in)
+{
+    // no puncturing, the four bits are the next four inputs
+    if (d_k == 1 && d_in_pos + 4 <= d_in_len) {
+        for (int i = 0; i < 4; i++) {
+            d_symbols[i] = GET_SOFT_BIT(in, d_in_pos + i);
+        }
+        d_in_pos += 4;
+        return d_symbols;
+    }
 
-                // Insert received bits
-                depunctured[count] = in[i * n_cbps + k];
-                count++;
+    for (int i = 0; i < 4; i++) {
+        if (d_depuncture_pattern[d_pattern_pos] && d_in_pos < d_in_len) {
+            d_symbols[i] = GET_SOFT_BIT(in, d_in_pos);
+            d_in_pos++;
+        } else {
+            d_symbols[i] = SOFT_ERASURE;
+        }
 
-                while (d_depuncture_pattern[count % (2 * d_k)] == 0) {
-                    depunctured[count] = 2;
-                    count++;
-                }
-            }
+        d_pattern_pos++;
+        if (d_pattern_pos == 2 * d_k) {
+            d_pattern_pos = 0;
         }
     }
 
-    return depunctured;
+    return d_symbols;
 }
 
 /* Parity lookup table */
@@ -77,3 +83,4 @@ const unsigned char base::PARTAB[256] = {
 const unsigned char base::PUNCTURE_1_2[2] = { 1, 1 };
 const unsigned char base::PUNCTURE_2_3[4] = { 1, 1, 1, 0 };
 const unsigned char base::PUNCTURE_3_4[6] = { 1, 1, 1, 0, 0, 1 };
+const unsigned char base::PUNCTURE_5_6[10] = { 1, 1, 1, 0, 0, 1, 1, 0, 0, 1 };
@@ -25,6 +25,31 @@ namespace ieee802_11 {
 // Maximum number of traceback bytes
 #define TRACEBACK_MAX 24
 
+// The input holds soft bits from 0 (a sure 0) to SOFT_MAX (a sure 1). Three
+// bits keep the spread of the path metrics below 128, which the modulo
+// comparison of the byte metrics needs.
+#define SOFT_BITS 3
+#define SOFT_MAX ((1 << SOFT_BITS) - 1)
+// depunctured bit, counts for neither branch
+#define SOFT_ERASURE 0xff
+
+// soft bits are stored packed, LSB first; the spare byte at the end lets
+// every soft bit be read from two bytes
+#define SOFT_BUFFER_SIZE(n) (((n) * SOFT_BITS + 7) / 8 + 1)
+#define GET_SOFT_BIT(buf, i)                                      \
+    ((((buf)[(i) * SOFT_BITS >> 3] |                              \
+       (buf)[((i) * SOFT_BITS >> 3) + 1] << 8) >>                 \
+      ((i) * SOFT_BITS & 7)) &                                    \
+     SOFT_MAX)
+// the buffer has to be cleared first
+#define SET_SOFT_BIT(buf, i, s)                                   \
+    do {                                                          \
+        int _pos = (i) * SOFT_BITS;                               \
+        int _val = (s) << (_pos & 7);                             \
+        (buf)[_pos >> 3] |= _val;                                 \
+        (buf)[(_pos >> 3) + 1] |= _val >> 8;                      \
+    } while (0)
+
 /* This Viterbi decoder was taken from the gr-dvbt module of
  * GNU Radio. It is an SSE2 version of the Viterbi Decoder
  * created by Phil Karn. The SSE2 version was made by Bogdan
@@ -51,16 +76,27 @@ protected:
     frame_param* d_frame;
     const unsigned char* d_depuncture_pattern;
 
-    uint8_t d_depunctured[MAX_ENCODED_BITS];
-    uint8_t d_decoded[MAX_ENCODED_BITS * 3 / 4];
+    // read position in the punctured input and number of received bits
+    int d_in_pos;
+    int d_in_len;
+    // position inside the periodic puncture pattern
+    int d_pattern_pos;
+    // four depunctured soft bits handed to the butterfly
+    uint8_t d_symbols[4];
+
+    // decoded bits, packed MSB first; n_data_bits is rounded up to full
+    // bytes by the caller and never exceeds the coded bits of the frame
+    uint8_t d_decoded[MAX_ENCODED_BITS / 8 + 1];
 
     static const unsigned char PARTAB[256];
     static const unsigned char PUNCTURE_1_2[2];
     static const unsigned char PUNCTURE_2_3[4];
     static const unsigned char PUNCTURE_3_4[6];
+    static const unsigned char PUNCTURE_5_6[10];
 
     virtual void reset() = 0;
-    uint8_t* depuncture(uint8_t* in);
+    void depuncture_init();
+    const uint8_t* depuncture_next(const uint8_t* in);
 };
 
 } // namespace ieee802_11
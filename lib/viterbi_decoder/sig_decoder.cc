@@ -0,0 +1,87 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "sig_decoder.h"
+
+using namespace gr::ieee802_11;
+
+static uint8_t parity(int n)
+{
+    uint8_t p = 0;
+    while (n) {
+        p ^= 1;
+        n &= n - 1;
+    }
+    return p;
+}
+
+sig_decoder::sig_decoder()
+{
+    // same generator polynomials as convolutional_encoding() in utils.cc,
+    // the index holds the six previous bits followed by the new input bit
+    for (int i = 0; i < 128; i++) {
+        d_out0[i] = parity(i & 0155);
+        d_out1[i] = parity(i & 0117);
+    }
+}
+
+const uint8_t* sig_decoder::decode(const float* soft)
+{
+    float* cur = d_metrics[0];
+    float* next = d_metrics[1];
+
+    // the encoder always starts in the zero state
+    cur[0] = 0;
+    for (int s = 1; s < 64; s++) {
+        cur[s] = -1e30f;
+    }
+
+    for (int t = 0; t < NUM_BITS_IN_HALOW_SIG_FIELD; t++) {
+        float y0 = soft[2 * t];
+        float y1 = soft[2 * t + 1];
+        uint64_t decisions = 0;
+
+        /* state n is reached from (n >> 1) and (n >> 1) | 32 with input
+         * bit n & 1; the branch metric is the correlation of the soft
+         * values with the expected encoder output */
+        for (int n = 0; n < 64; n++) {
+            int a = n;
+            int b = n | 64;
+            float ma = cur[n >> 1] + (d_out0[a] ? y0 : -y0) + (d_out1[a] ? y1 : -y1);
+            float mb = cur[(n >> 1) | 32] + (d_out0[b] ? y0 : -y0) +
+                       (d_out1[b] ? y1 : -y1);
+            if (mb > ma) {
+                next[n] = mb;
+                decisions |= uint64_t(1) << n;
+            } else {
+                next[n] = ma;
+            }
+        }
+        d_decisions[t] = decisions;
+
+        float* tmp = cur;
+        cur = next;
+        next = tmp;
+    }
+
+    // the tail bits bring the encoder back to zero, trace back from there
+    int state = 0;
+    for (int t = NUM_BITS_IN_HALOW_SIG_FIELD - 1; t >= 0; t--) {
+        d_decoded[t] = state & 1;
+        state = (state >> 1) | (((d_decisions[t] >> state) & 1) << 5);
+    }
+
+    return d_decoded;
+}
@@ -0,0 +1,55 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef INCLUDED_IEEE802_11_VITERBI_DECODER_SIG_DECODER_H
+#define INCLUDED_IEEE802_11_VITERBI_DECODER_SIG_DECODER_H
+
+#include "../utils.h"
+
+namespace gr {
+namespace ieee802_11 {
+
+#define NUM_CODED_BITS_IN_HALOW_SIG_FIELD \
+    (NUM_OFDM_SYMBOLS_IN_SIG_FIELD * NUM_BITS_UNREPEATED_SIG_SYMBOL)
+
+/* Soft decision Viterbi decoder for the SIG field only.
+ *
+ * The SIG field is always 36 bits, rate 1/2 and terminated by 6 tail bits,
+ * so the whole trellis fits in a few hundred bytes: the decoder keeps one
+ * 64 bit survivor mask per stage and does a single full traceback from the
+ * zero state, instead of the sliding window of the generic data decoder.
+ */
+class sig_decoder
+{
+public:
+    sig_decoder();
+
+    /* soft: the 72 combined (unrepeated) BPSK values of the SIG field,
+     * positive means 1. Returns the 36 decoded bits. */
+    const uint8_t* decode(const float* soft);
+
+private:
+    float d_metrics[2][64];
+    uint64_t d_decisions[NUM_BITS_IN_HALOW_SIG_FIELD];
+    uint8_t d_decoded[NUM_BITS_IN_HALOW_SIG_FIELD];
+
+    // encoder outputs for the 128 (state, input) combinations
+    uint8_t d_out0[128];
+    uint8_t d_out1[128];
+};
+
+} // namespace ieee802_11
+} // namespace gr
+
+#endif /* INCLUDED_IEEE802_11_VITERBI_DECODER_SIG_DECODER_H */
@@ -84,7 +84,7 @@
 using namespace gr::ieee802_11;
 
 
-void viterbi_decoder::viterbi_butterfly2_generic(unsigned char* symbols,
+void viterbi_decoder::viterbi_butterfly2_generic(const unsigned char* symbols,
                                                  unsigned char* mm0,
                                                  unsigned char* mm1,
                                                  unsigned char* pp0,
@@ -116,21 +116,26 @@ void viterbi_decoder::viterbi_butterfly2_generic(unsigned char* symbols,
     }
 
     for (i = 0; i < 2; i++) {
-        if (symbols[0] == 2) {
+        if (symbols[0] == SOFT_ERASURE && symbols[1] == SOFT_ERASURE) {
+            for (j = 0; j < 16; j++) {
+                metsvm[j] = 0;
+                metsv[j] = 0;
+            }
+        } else if (symbols[0] == SOFT_ERASURE) {
             for (j = 0; j < 16; j++) {
                 metsvm[j] = d_branchtab27_generic[1].c[(i * 16) + j] ^ sym1v[j];
-                metsv[j] = 1 - metsvm[j];
+                metsv[j] = SOFT_MAX - metsvm[j];
             }
-        } else if (symbols[1] == 2) {
+        } else if (symbols[1] == SOFT_ERASURE) {
             for (j = 0; j < 16; j++) {
                 metsvm[j] = d_branchtab27_generic[0].c[(i * 16) + j] ^ sym0v[j];
-                metsv[j] = 1 - metsvm[j];
+                metsv[j] = SOFT_MAX - metsvm[j];
             }
         } else {
             for (j = 0; j < 16; j++) {
                 metsvm[j] = (d_branchtab27_generic[0].c[(i * 16) + j] ^ sym0v[j]) +
                             (d_branchtab27_generic[1].c[(i * 16) + j] ^ sym1v[j]);
-                metsv[j] = 2 - metsvm[j];
+                metsv[j] = 2 * SOFT_MAX - metsvm[j];
             }
         }
 
@@ -202,21 +207,26 @@ void viterbi_decoder::viterbi_butterfly2_generic(unsigned char* symbols,
     }
 
     for (i = 0; i < 2; i++) {
-        if (symbols[2] == 2) {
+        if (symbols[2] == SOFT_ERASURE && symbols[3] == SOFT_ERASURE) {
+            for (j = 0; j < 16; j++) {
+                metsvm[j] = 0;
+                metsv[j] = 0;
+            }
+        } else if (symbols[2] == SOFT_ERASURE) {
             for (j = 0; j < 16; j++) {
                 metsvm[j] = d_branchtab27_generic[1].c[(i * 16) + j] ^ sym1v[j];
-                metsv[j] = 1 - metsvm[j];
+                metsv[j] = SOFT_MAX - metsvm[j];
             }
-        } else if (symbols[3] == 2) {
+        } else if (symbols[3] == SOFT_ERASURE) {
             for (j = 0; j < 16; j++) {
                 metsvm[j] = d_branchtab27_generic[0].c[(i * 16) + j] ^ sym0v[j];
-                metsv[j] = 1 - metsvm[j];
+                metsv[j] = SOFT_MAX - metsvm[j];
             }
         } else {
             for (j = 0; j < 16; j++) {
                 metsvm[j] = (d_branchtab27_generic[0].c[(i * 16) + j] ^ sym0v[j]) +
                             (d_branchtab27_generic[1].c[(i * 16) + j] ^ sym1v[j]);
-                metsv[j] = 2 - metsvm[j];
+                metsv[j] = 2 * SOFT_MAX - metsvm[j];
             }
         }
 
@@ -343,7 +353,7 @@ uint8_t* viterbi_decoder::decode(ofdm_param* ofdm, frame_param* frame, uint8_t*
     d_frame = frame;
 
     reset();
-    uint8_t* depunctured = depuncture(in);
+    depuncture_init();
 
     int in_count = 0;
     int out_count = 0;
@@ -352,7 +362,7 @@ uint8_t* viterbi_decoder::decode(ofdm_param* ofdm, frame_param* frame, uint8_t*
     while (n_decoded < d_frame->n_data_bits) {
 
         if ((in_count % 4) == 0) { // 0 or 3
-            viterbi_butterfly2_generic(&depunctured[in_count & 0xfffffffc],
+            viterbi_butterfly2_generic(depuncture_next(in),
                                        d_metric0_generic,
                                        d_metric1_generic,
                                        d_path0_generic,
@@ -365,11 +375,8 @@ uint8_t* viterbi_decoder::decode(ofdm_param* ofdm, frame_param* frame, uint8_t*
                     d_metric0_generic, d_path0_generic, d_ntraceback, &c);
 
                 if (out_count >= d_ntraceback) {
-                    for (int i = 0; i < 8; i++) {
-                        d_decoded[(out_count - d_ntraceback) * 8 + i] =
-                            (c >> (7 - i)) & 0x1;
-                        n_decoded++;
-                    }
+                    d_decoded[out_count - d_ntraceback] = c;
+                    n_decoded += 8;
                 }
                 out_count++;
             }
@@ -402,10 +409,17 @@ void viterbi_decoder::reset()
     case QPSK_3_4:
     case QAM16_3_4:
     case QAM64_3_4:
+    case QAM256_3_4:
         d_ntraceback = 10;
         d_depuncture_pattern = PUNCTURE_3_4;
         d_k = 3;
         break;
+    case QAM64_5_6:
+    case QAM256_5_6:
+        d_ntraceback = 12;
+        d_depuncture_pattern = PUNCTURE_5_6;
+        d_k = 5;
+        break;
     }
 }
 
@@ -422,9 +436,9 @@ void viterbi_decoder::viterbi_chunks_init_generic()
     int polys[2] = { 0x6d, 0x4f };
     for (i = 0; i < 32; i++) {
         d_branchtab27_generic[0].c[i] =
-            (polys[0] < 0) ^ PARTAB[(2 * i) & abs(polys[0])] ? 1 : 0;
+            (polys[0] < 0) ^ PARTAB[(2 * i) & abs(polys[0])] ? SOFT_MAX : 0;
         d_branchtab27_generic[1].c[i] =
-            (polys[1] < 0) ^ PARTAB[(2 * i) & abs(polys[1])] ? 1 : 0;
+            (polys[1] < 0) ^ PARTAB[(2 * i) & abs(polys[1])] ? SOFT_MAX : 0;
     }
 
     for (i = 0; i < 64; i++) {
@@ -45,7 +45,7 @@ private:
     void reset();
 
     void viterbi_chunks_init_generic();
-    void viterbi_butterfly2_generic(unsigned char* symbols,
+    void viterbi_butterfly2_generic(const unsigned char* symbols,
                                     unsigned char m0[],
                                     unsigned char m1[],
                                     unsigned char p0[],
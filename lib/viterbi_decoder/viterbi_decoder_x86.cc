@@ -84,7 +84,7 @@
 using namespace gr::ieee802_11;
 
 void viterbi_decoder::viterbi_butterfly2_sse2(
-    unsigned char* symbols, __m128i* mm0, __m128i* mm1, __m128i* pp0, __m128i* pp1)
+    const unsigned char* symbols, __m128i* mm0, __m128i* mm1, __m128i* pp0, __m128i* pp1)
 {
     int i;
 
@@ -108,16 +108,19 @@ void viterbi_decoder::viterbi_butterfly2_sse2(
     sym1v = _mm_set1_epi8(symbols[1]);
 
     for (i = 0; i < 2; i++) {
-        if (symbols[0] == 2) {
+        if (symbols[0] == SOFT_ERASURE && symbols[1] == SOFT_ERASURE) {
+            metsvm = _mm_setzero_si128();
+            metsv = _mm_setzero_si128();
+        } else if (symbols[0] == SOFT_ERASURE) {
             metsvm = _mm_xor_si128(d_branchtab27_sse2[1].v[i], sym1v);
-            metsv = _mm_sub_epi8(_mm_set1_epi8(1), metsvm);
-        } else if (symbols[1] == 2) {
+            metsv = _mm_sub_epi8(_mm_set1_epi8(SOFT_MAX), metsvm);
+        } else if (symbols[1] == SOFT_ERASURE) {
             metsvm = _mm_xor_si128(d_branchtab27_sse2[0].v[i], sym0v);
-            metsv = _mm_sub_epi8(_mm_set1_epi8(1), metsvm);
+            metsv = _mm_sub_epi8(_mm_set1_epi8(SOFT_MAX), metsvm);
         } else {
             metsvm = _mm_add_epi8(_mm_xor_si128(d_branchtab27_sse2[0].v[i], sym0v),
                                   _mm_xor_si128(d_branchtab27_sse2[1].v[i], sym1v));
-            metsv = _mm_sub_epi8(_mm_set1_epi8(2), metsvm);
+            metsv = _mm_sub_epi8(_mm_set1_epi8(2 * SOFT_MAX), metsvm);
         }
 
         m0 = _mm_add_epi8(metric0[i], metsv);
@@ -157,18 +160,21 @@ void viterbi_decoder::viterbi_butterfly2_sse2(
     sym1v = _mm_set1_epi8(symbols[3]);
 
     for (i = 0; i < 2; i++) {
-        if (symbols[2] == 2) {
+        if (symbols[2] == SOFT_ERASURE && symbols[3] == SOFT_ERASURE) {
+            metsvm = _mm_setzero_si128();
+            metsv = _mm_setzero_si128();
+        } else if (symbols[2] == SOFT_ERASURE) {
             metsvm = _mm_xor_si128(d_branchtab27_sse2[1].v[i], sym1v);
-            metsv = _mm_sub_epi8(_mm_set1_epi8(1), metsvm);
+            metsv = _mm_sub_epi8(_mm_set1_epi8(SOFT_MAX), metsvm);
 
-        } else if (symbols[3] == 2) {
+        } else if (symbols[3] == SOFT_ERASURE) {
             metsvm = _mm_xor_si128(d_branchtab27_sse2[0].v[i], sym0v);
-            metsv = _mm_sub_epi8(_mm_set1_epi8(1), metsvm);
+            metsv = _mm_sub_epi8(_mm_set1_epi8(SOFT_MAX), metsvm);
 
         } else {
             metsvm = _mm_add_epi8(_mm_xor_si128(d_branchtab27_sse2[0].v[i], sym0v),
                                   _mm_xor_si128(d_branchtab27_sse2[1].v[i], sym1v));
-            metsv = _mm_sub_epi8(_mm_set1_epi8(2), metsvm);
+            metsv = _mm_sub_epi8(_mm_set1_epi8(2 * SOFT_MAX), metsvm);
         }
 
         m0 = _mm_add_epi8(metric0[i], metsv);
@@ -263,7 +269,7 @@ uint8_t* viterbi_decoder::decode(ofdm_param* ofdm, frame_param* frame, uint8_t*
     d_frame = frame;
 
     reset();
-    uint8_t* depunctured = depuncture(in);
+    depuncture_init();
 
     int in_count = 0;
     int out_count = 0;
@@ -272,7 +278,7 @@ uint8_t* viterbi_decoder::decode(ofdm_param* ofdm, frame_param* frame, uint8_t*
     while (n_decoded < d_frame->n_data_bits) {
 
         if ((in_count % 4) == 0) { // 0 or 3
-            viterbi_butterfly2_sse2(&depunctured[in_count & 0xfffffffc],
+            viterbi_butterfly2_sse2(depuncture_next(in),
                                     d_metric0,
                                     d_metric1,
                                     d_path0,
@@ -284,11 +290,8 @@ uint8_t* viterbi_decoder::decode(ofdm_param* ofdm, frame_param* frame, uint8_t*
                 viterbi_get_output_sse2(d_metric0, d_path0, d_ntraceback, &c);
 
                 if (out_count >= d_ntraceback) {
-                    for (int i = 0; i < 8; i++) {
-                        d_decoded[(out_count - d_ntraceback) * 8 + i] =
-                            (c >> (7 - i)) & 0x1;
-                        n_decoded++;
-                    }
+                    d_decoded[out_count - d_ntraceback] = c;
+                    n_decoded += 8;
                 }
                 out_count++;
             }
@@ -321,10 +324,17 @@ void viterbi_decoder::reset()
     case QPSK_3_4:
     case QAM16_3_4:
     case QAM64_3_4:
+    case QAM256_3_4:
         d_ntraceback = 10;
         d_depuncture_pattern = PUNCTURE_3_4;
         d_k = 3;
         break;
+    case QAM64_5_6:
+    case QAM256_5_6:
+        d_ntraceback = 12;
+        d_depuncture_pattern = PUNCTURE_5_6;
+        d_k = 5;
+        break;
     }
 }
 
@@ -341,9 +351,9 @@ void viterbi_decoder::viterbi_chunks_init_sse2()
     int polys[2] = { 0x6d, 0x4f };
     for (i = 0; i < 32; i++) {
         d_branchtab27_sse2[0].c[i] =
-            (polys[0] < 0) ^ PARTAB[(2 * i) & abs(polys[0])] ? 1 : 0;
+            (polys[0] < 0) ^ PARTAB[(2 * i) & abs(polys[0])] ? SOFT_MAX : 0;
         d_branchtab27_sse2[1].c[i] =
-            (polys[1] < 0) ^ PARTAB[(2 * i) & abs(polys[1])] ? 1 : 0;
+            (polys[1] < 0) ^ PARTAB[(2 * i) & abs(polys[1])] ? SOFT_MAX : 0;
     }
 
     for (i = 0; i < 64; i++) {
@@ -48,7 +48,7 @@ private:
 
     void viterbi_chunks_init_sse2();
     void viterbi_butterfly2_sse2(
-        unsigned char* symbols, __m128i m0[], __m128i m1[], __m128i p0[], __m128i p1[]);
+        const unsigned char* symbols, __m128i m0[], __m128i m1[], __m128i p0[], __m128i p1[]);
     unsigned char viterbi_get_output_sse2(__m128i* mm0,
                                           __m128i* pp0,
                                           int ntraceback,
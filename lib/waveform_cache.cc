@@ -0,0 +1,111 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "waveform_cache.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace gr::ieee802_11;
+
+// PSDUs repeated() remembers
+#define HISTORY_SIZE 256
+
+waveform_cache::waveform_cache(size_t max_bytes)
+    : d_max_bytes(max_bytes), d_bytes(0), d_hits(0), d_misses(0)
+{
+    if (max_bytes < 1) {
+        throw std::invalid_argument("waveform cache needs room for at least one frame");
+    }
+}
+
+waveform_cache::key_t
+waveform_cache::make_key(const char* psdu, int len, Encoding encoding, uint8_t scrambler)
+{
+    // 64 bit FNV-1a, straight on the PSDU
+    uint64_t hash = 0xcbf29ce484222325;
+    for (int i = 0; i < len; i++) {
+        hash = (hash ^ uint8_t(psdu[i])) * 0x100000001b3;
+    }
+    return key_t(hash, len, encoding, scrambler);
+}
+
+waveform_cache::samples_ptr
+waveform_cache::lookup(const char* psdu, int len, Encoding encoding, uint8_t scrambler)
+{
+    auto it = d_index.find(make_key(psdu, len, encoding, scrambler));
+
+    if (it == d_index.end() || std::memcmp(it->second->psdu.data(), psdu, len)) {
+        d_misses++;
+        return samples_ptr();
+    }
+
+    // move to the front
+    d_entries.splice(d_entries.begin(), d_entries, it->second);
+    d_hits++;
+    return it->second->samples;
+}
+
+bool waveform_cache::repeated(const char* psdu, int len, Encoding encoding)
+{
+    key_t key = make_key(psdu, len, encoding, 0);
+
+    auto it = std::find(d_history.begin(), d_history.end(), key);
+    bool found = it != d_history.end();
+    if (found) {
+        d_history.erase(it);
+    } else if (d_history.size() == HISTORY_SIZE) {
+        d_history.pop_front();
+    }
+    d_history.push_back(key);
+    return found;
+}
+
+void waveform_cache::clear()
+{
+    d_entries.clear();
+    d_index.clear();
+    d_history.clear();
+    d_bytes = 0;
+}
+
+void waveform_cache::erase(std::list<entry>::iterator it)
+{
+    d_bytes -= it->psdu.size() + it->samples->size() * sizeof(gr_complex);
+    d_index.erase(it->key);
+    d_entries.erase(it);
+}
+
+void waveform_cache::insert(
+    const char* psdu, int len, Encoding encoding, uint8_t scrambler, samples_ptr samples)
+{
+    key_t key = make_key(psdu, len, encoding, scrambler);
+    size_t bytes = len + samples->size() * sizeof(gr_complex);
+    if (bytes > d_max_bytes) {
+        return;
+    }
+
+    // same key, but a different PSDU
+    auto it = d_index.find(key);
+    if (it != d_index.end()) {
+        erase(it->second);
+    }
+
+    while (d_bytes + bytes > d_max_bytes) {
+        erase(std::prev(d_entries.end()));
+    }
+
+    d_entries.push_front(entry{ key, std::vector<char>(psdu, psdu + len), samples });
+    d_index[key] = d_entries.begin();
+    d_bytes += bytes;
+}
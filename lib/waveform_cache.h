@@ -0,0 +1,95 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef INCLUDED_IEEE802_11_WAVEFORM_CACHE_H
+#define INCLUDED_IEEE802_11_WAVEFORM_CACHE_H
+
+#include "utils.h"
+#include <deque>
+#include <list>
+#include <map>
+#include <memory>
+#include <tuple>
+
+namespace gr {
+namespace ieee802_11 {
+
+/* LRU cache of modulated frames.
+ *
+ * The baseband samples of a frame only depend on the PSDU, the encoding and
+ * the scrambler seed, so frames that are sent over and over (beacons, probe
+ * responses) can skip encoding and modulation once they are in the cache.
+ * Entries are looked up by a hash of the PSDU together with the encoding and
+ * the seed; the PSDU is stored as well to rule out hash collisions. The
+ * cache holds at most max_bytes of samples and PSDUs.
+ *
+ * Most frames are sent once, so repeated() keeps the hashes of the recent
+ * PSDUs to tell the frames worth caching from the others.
+ */
+class waveform_cache
+{
+public:
+    typedef std::shared_ptr<const std::vector<gr_complex>> samples_ptr;
+
+    // least recently used frames are evicted once they take up max_bytes
+    waveform_cache(size_t max_bytes);
+
+    // returns the samples of the frame or an empty pointer on a miss
+    samples_ptr lookup(const char* psdu, int len, Encoding encoding, uint8_t scrambler);
+    void insert(const char* psdu,
+                int len,
+                Encoding encoding,
+                uint8_t scrambler,
+                samples_ptr samples);
+
+    // true if the PSDU was sent with this encoding not long ago, whatever
+    // the scrambler seed, and remembers it for the next time
+    bool repeated(const char* psdu, int len, Encoding encoding);
+
+    void clear();
+
+    uint64_t hits() const { return d_hits; }
+    uint64_t misses() const { return d_misses; }
+    int size() const { return d_entries.size(); }
+    size_t bytes() const { return d_bytes; }
+
+private:
+    typedef std::tuple<uint64_t, int, int, uint8_t> key_t;
+
+    struct entry {
+        key_t key;
+        std::vector<char> psdu;
+        samples_ptr samples;
+    };
+
+    static key_t make_key(const char* psdu, int len, Encoding encoding, uint8_t scrambler);
+    void erase(std::list<entry>::iterator it);
+
+    size_t d_max_bytes;
+    size_t d_bytes;
+    uint64_t d_hits;
+    uint64_t d_misses;
+
+    // most recently used first
+    std::list<entry> d_entries;
+    std::map<key_t, std::list<entry>::iterator> d_index;
+
+    // keys (without seed) of the recently sent PSDUs, most recent last
+    std::deque<key_t> d_history;
+};
+
+} // namespace ieee802_11
+} // namespace gr
+
+#endif /* INCLUDED_IEEE802_11_WAVEFORM_CACHE_H */
@@ -14,7 +14,7 @@
 /* BINDTOOL_GEN_AUTOMATIC(0)                                                       */
 /* BINDTOOL_USE_PYGCCXML(0)                                                        */
 /* BINDTOOL_HEADER_FILE(chunks_to_symbols.h)                                        */
-/* BINDTOOL_HEADER_FILE_HASH(3d2f4de89018fc7c7ee96d450ca48179)                     */
+/* BINDTOOL_HEADER_FILE_HASH(58f68f6486f6c69a9643b373e1a946ae)                     */
 /***********************************************************************************/
 
 #include <pybind11/complex.h>
@@ -33,7 +33,7 @@ void bind_chunks_to_symbols(py::module& m)
     using chunks_to_symbols    = ::gr::ieee802_11::chunks_to_symbols;
 
 
-    py::class_<chunks_to_symbols, gr::tagged_stream_block, gr::block, gr::basic_block,
+    py::class_<chunks_to_symbols, gr::sync_block, gr::block, gr::basic_block,
         std::shared_ptr<chunks_to_symbols>>(m, "chunks_to_symbols", D(chunks_to_symbols))
 
         .def(py::init(&chunks_to_symbols::make),
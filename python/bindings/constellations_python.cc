@@ -14,7 +14,7 @@
 /* BINDTOOL_GEN_AUTOMATIC(0)                                                       */
 /* BINDTOOL_USE_PYGCCXML(0)                                                        */
 /* BINDTOOL_HEADER_FILE(constellations.h)                                        */
-/* BINDTOOL_HEADER_FILE_HASH(b80d50dfe0fc254d8d6101aee3d2bcad)                     */
+/* BINDTOOL_HEADER_FILE_HASH(49d7aecb94bc1bd63b672f68cd7939e8)                     */
 /***********************************************************************************/
 
 #include <pybind11/complex.h>
@@ -112,6 +112,20 @@ void bind_constellations(py::module& m)
         ;
 
 
+    py::class_<constellation_256qam, gr::digital::constellation,
+        std::shared_ptr<constellation_256qam>>(m, "constellation_256qam", D(constellation_256qam), py::multiple_inheritance())
+
+        .def(py::init(&constellation_256qam::make),
+           D(constellation_256qam,make)
+        )
+
+        .def("base",&constellation_256qam::base,
+            D(constellation_256qam,base)
+        )
+
+        ;
+
+
 
 
 }
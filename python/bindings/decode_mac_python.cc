@@ -14,7 +14,7 @@
 /* BINDTOOL_GEN_AUTOMATIC(0)                                                       */
 /* BINDTOOL_USE_PYGCCXML(0)                                                        */
 /* BINDTOOL_HEADER_FILE(decode_mac.h)                                        */
-/* BINDTOOL_HEADER_FILE_HASH(cace2c32f544fb653ce489c979eb4082)                     */
+/* BINDTOOL_HEADER_FILE_HASH(af04761a0fc7fb63cc39cbdbb7d4535e)                     */
 /***********************************************************************************/
 
 #include <pybind11/complex.h>
@@ -39,6 +39,9 @@ void bind_decode_mac(py::module& m)
         .def(py::init(&decode_mac::make),
            py::arg("log") = false,
            py::arg("debug") = false,
+           py::arg("sifs_ack") = false,
+           py::arg("src_mac") = std::vector<uint8_t>(6, 0x23),
+           py::arg("ndp_ack") = false,
            D(decode_mac,make)
         )
         
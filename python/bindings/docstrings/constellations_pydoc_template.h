@@ -63,4 +63,16 @@
 
  static const char *__doc_gr_ieee802_11_constellation_64qam_base = R"doc()doc";
 
+ 
+ static const char *__doc_gr_ieee802_11_constellation_256qam = R"doc()doc";
+
+
+ static const char *__doc_gr_ieee802_11_constellation_256qam_constellation_256qam = R"doc()doc";
+
+
+ static const char *__doc_gr_ieee802_11_constellation_256qam_make = R"doc()doc";
+
+
+ static const char *__doc_gr_ieee802_11_constellation_256qam_base = R"doc()doc";
+
   
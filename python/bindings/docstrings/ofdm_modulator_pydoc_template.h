@@ -0,0 +1,39 @@
+/*
+ * Copyright 2021 Free Software Foundation, Inc.
+ *
+ * This file is part of GNU Radio
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ */
+#include "pydoc_macros.h"
+#define D(...) DOC(gr,ieee802_11, __VA_ARGS__ )
+/*
+  This file contains placeholders for docstrings for the Python bindings.
+  Do not edit! These were automatically extracted during the binding process
+  and will be overwritten during the build process
+ */
+
+
+ 
+ static const char *__doc_gr_ieee802_11_ofdm_modulator = R"doc()doc";
+
+
+ static const char *__doc_gr_ieee802_11_ofdm_modulator_ofdm_modulator_0 = R"doc()doc";
+
+
+ static const char *__doc_gr_ieee802_11_ofdm_modulator_ofdm_modulator_1 = R"doc()doc";
+
+
+ static const char *__doc_gr_ieee802_11_ofdm_modulator_make = R"doc()doc";
+
+
+ static const char *__doc_gr_ieee802_11_ofdm_modulator_set_encoding = R"doc()doc";
+
+
+ static const char *__doc_gr_ieee802_11_ofdm_modulator_set_short_gi = R"doc()doc";
+
+
+ static const char *__doc_gr_ieee802_11_ofdm_modulator_set_ldpc = R"doc()doc";
+
+  
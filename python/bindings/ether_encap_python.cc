@@ -14,7 +14,7 @@
 /* BINDTOOL_GEN_AUTOMATIC(0)                                                       */
 /* BINDTOOL_USE_PYGCCXML(0)                                                        */
 /* BINDTOOL_HEADER_FILE(ether_encap.h)                                        */
-/* BINDTOOL_HEADER_FILE_HASH(280e9072b32d4443bd89d2ad5560bdea)                     */
+/* BINDTOOL_HEADER_FILE_HASH(5203fbb5839ad7b57bd80db1332c7aa2)                     */
 /***********************************************************************************/
 
 #include <pybind11/complex.h>
@@ -38,6 +38,8 @@ void bind_ether_encap(py::module& m)
 
         .def(py::init(&ether_encap::make),
            py::arg("debug"),
+           py::arg("short_header") = false,
+           py::arg("sta_mac") = std::vector<uint8_t>(6, 0x42),
            D(ether_encap,make)
         )
         
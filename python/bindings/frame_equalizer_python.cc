@@ -14,7 +14,7 @@
 /* BINDTOOL_GEN_AUTOMATIC(0)                                                       */
 /* BINDTOOL_USE_PYGCCXML(0)                                                        */
 /* BINDTOOL_HEADER_FILE(frame_equalizer.h)                                        */
-/* BINDTOOL_HEADER_FILE_HASH(16ff5ed7a4d765b220d8e93bba89c627)                     */
+/* BINDTOOL_HEADER_FILE_HASH(c4ccbf6b9b23c9f60ade8ddf2021df89)                     */
 /***********************************************************************************/
 
 #include <pybind11/complex.h>
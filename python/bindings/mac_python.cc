@@ -14,7 +14,7 @@
 /* BINDTOOL_GEN_AUTOMATIC(0)                                                       */
 /* BINDTOOL_USE_PYGCCXML(0)                                                        */
 /* BINDTOOL_HEADER_FILE(mac.h)                                        */
-/* BINDTOOL_HEADER_FILE_HASH(1c47a20e97ec549a0e6ec5362f06ad6f)                     */
+/* BINDTOOL_HEADER_FILE_HASH(8bc8255aef6cbaee38a3c4edae6c604e)                     */
 /***********************************************************************************/
 
 #include <pybind11/complex.h>
@@ -40,6 +40,24 @@ void bind_mac(py::module& m)
            py::arg("src_mac"),
            py::arg("dst_mac"),
            py::arg("bss_mac"),
+           py::arg("ampdu_size") = 0,
+           py::arg("ampdu_delay") = 0.01,
+           py::arg("frag_threshold") = 511,
+           py::arg("arq") = false,
+           py::arg("retry_limit") = 7,
+           py::arg("ack_timeout") = 0.05,
+           py::arg("loss_rate") = 0,
+           py::arg("rate_control") = false,
+           py::arg("encoding") = ::gr::ieee802_11::BPSK_1_2,
+           py::arg("queue_limits") = std::vector<int>{ 16, 16, 64, 64 },
+           py::arg("short_header") = false,
+           py::arg("aid") = 1,
+           py::arg("ndp_ack") = false,
+           py::arg("csma") = false,
+           py::arg("duty_cycle") = 1,
+           py::arg("duty_window") = 3600,
+           py::arg("sifs_ack") = false,
+           py::arg("ldpc") = false,
            D(mac,make)
         )
         
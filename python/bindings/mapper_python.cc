@@ -14,7 +14,7 @@
 /* BINDTOOL_GEN_AUTOMATIC(0)                                                       */
 /* BINDTOOL_USE_PYGCCXML(0)                                                        */
 /* BINDTOOL_HEADER_FILE(mapper.h)                                        */
-/* BINDTOOL_HEADER_FILE_HASH(b03e5a0662e0689869218b550814d68e)                     */
+/* BINDTOOL_HEADER_FILE_HASH(eb7c9fb46466337a36407cb418fd2bd7)                     */
 /***********************************************************************************/
 
 #include <pybind11/complex.h>
@@ -39,6 +39,7 @@ void bind_mapper(py::module& m)
         .def(py::init(&mapper::make),
            py::arg("mcs"),
            py::arg("debug") = false,
+           py::arg("ldpc") = false,
            D(mapper,make)
         )
         
@@ -52,6 +53,12 @@ void bind_mapper(py::module& m)
             D(mapper,set_encoding)
         )
 
+
+        .def("set_ldpc",&mapper::set_ldpc,
+            py::arg("ldpc"),
+            D(mapper,set_ldpc)
+        )
+
         ;
 
     py::enum_<::gr::ieee802_11::Encoding>(m,"Encoding")
@@ -63,6 +70,8 @@ void bind_mapper(py::module& m)
         .value("QAM64_2_3", ::gr::ieee802_11::QAM64_2_3) // 5
         .value("QAM64_3_4", ::gr::ieee802_11::QAM64_3_4) // 6
         .value("QAM64_5_6", ::gr::ieee802_11::QAM64_5_6) // 7
+        .value("QAM256_3_4", ::gr::ieee802_11::QAM256_3_4) // 8
+        .value("QAM256_5_6", ::gr::ieee802_11::QAM256_5_6) // 9
         .value("BPSK_1_2_REP", ::gr::ieee802_11::BPSK_1_2_REP) //10
         .export_values()
     ;
@@ -0,0 +1,69 @@
+/*
+ * Copyright 2021 Free Software Foundation, Inc.
+ *
+ * This file is part of GNU Radio
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ */
+
+/***********************************************************************************/
+/* This file is automatically generated using bindtool and can be manually edited  */
+/* The following lines can be configured to regenerate this file during cmake      */
+/* If manual edits are made, the following tags should be modified accordingly.    */
+/* BINDTOOL_GEN_AUTOMATIC(0)                                                       */
+/* BINDTOOL_USE_PYGCCXML(0)                                                        */
+/* BINDTOOL_HEADER_FILE(ofdm_modulator.h)                                        */
+/* BINDTOOL_HEADER_FILE_HASH(e82b3291bbc4e9fc7ac7b17c644aea88)                     */
+/***********************************************************************************/
+
+#include <pybind11/complex.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+namespace py = pybind11;
+
+#include <ieee802_11/ofdm_modulator.h>
+// pydoc.h is automatically generated in the build directory
+#include <ofdm_modulator_pydoc.h>
+
+void bind_ofdm_modulator(py::module& m)
+{
+
+    using ofdm_modulator    = ::gr::ieee802_11::ofdm_modulator;
+
+
+    py::class_<ofdm_modulator, gr::block, gr::basic_block,
+        std::shared_ptr<ofdm_modulator>>(m, "ofdm_modulator", D(ofdm_modulator))
+
+        .def(py::init(&ofdm_modulator::make),
+           py::arg("mcs"),
+           py::arg("debug") = false,
+           py::arg("cache_size") = 0,
+           py::arg("short_gi") = false,
+           py::arg("ldpc") = false,
+           D(ofdm_modulator,make)
+        )
+
+
+        .def("set_encoding",&ofdm_modulator::set_encoding,
+            py::arg("mcs"),
+            D(ofdm_modulator,set_encoding)
+        )
+
+
+        .def("set_short_gi",&ofdm_modulator::set_short_gi,
+            py::arg("short_gi"),
+            D(ofdm_modulator,set_short_gi)
+        )
+
+
+        .def("set_ldpc",&ofdm_modulator::set_ldpc,
+            py::arg("ldpc"),
+            D(ofdm_modulator,set_ldpc)
+        )
+
+        ;
+
+
+}
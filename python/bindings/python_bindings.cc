@@ -29,6 +29,7 @@ void bind_extract_csi(py::module& m);
 void bind_frame_equalizer(py::module& m);
 void bind_mac(py::module& m);
 void bind_mapper(py::module& m);
+void bind_ofdm_modulator(py::module& m);
 void bind_parse_mac(py::module& m);
 void bind_signal_field(py::module& m);
 void bind_sync_long(py::module& m);
@@ -70,6 +71,7 @@ PYBIND11_MODULE(ieee802_11_python, m)
     bind_frame_equalizer(m);
     bind_mac(m);
     bind_mapper(m);
+    bind_ofdm_modulator(m);
     bind_parse_mac(m);
     bind_signal_field(m);
     bind_sync_long(m);
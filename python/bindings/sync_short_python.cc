@@ -14,7 +14,7 @@
 /* BINDTOOL_GEN_AUTOMATIC(0)                                                       */
 /* BINDTOOL_USE_PYGCCXML(0)                                                        */
 /* BINDTOOL_HEADER_FILE(sync_short.h)                                        */
-/* BINDTOOL_HEADER_FILE_HASH(ce2bf4884eae2d4c7695586469e38b17)                     */
+/* BINDTOOL_HEADER_FILE_HASH(e2f663dc21c6a67e6ac77d7497e71f00)                     */
 /***********************************************************************************/
 
 #include <pybind11/complex.h>
@@ -41,6 +41,7 @@ void bind_sync_short(py::module& m)
            py::arg("min_plateau"),
            py::arg("log") = false,
            py::arg("debug") = false,
+           py::arg("cca_threshold") = -20,
            D(sync_short,make)
         )
         